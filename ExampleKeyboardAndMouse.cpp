@@ -111,6 +111,7 @@ protected:
         {
             case Mode::TrueColor: printf("truecolor"); break;
             case Mode::FloatingPoint: printf("floating point"); break;
+            case Mode::Indexed: printf("indexed"); break;
         }
         switch (display.output())
         {
@@ -1,5 +1,5 @@
 // Multiple Displays Example.
-// Demonstrates how to open and update multiple displays.
+// Demonstrates how to open multiple displays and update them together with a display group.
 // Part of the PixelToaster Framebuffer Library - http://www.pixeltoaster.com
 
 #include "PixelToaster.h"
@@ -53,6 +53,11 @@ int main()
 
     vector<Pixel> pixels(width * height);
 
+    DisplayGroup group;
+    group.add(a, pixels.data());
+    group.add(b, pixels.data());
+    group.add(c, pixels.data());
+
     while (a.open() || b.open() || c.open())
     {
         unsigned int index = 0;
@@ -69,31 +74,6 @@ int main()
             }
         }
 
-        if (a.open())
-        {
-#ifdef PIXELTOASTER_NO_STL
-            a.update(pixels.data());
-#else
-            a.update(pixels);
-#endif
-        }
-
-        if (b.open())
-        {
-#ifdef PIXELTOASTER_NO_STL
-            b.update(pixels.data());
-#else
-            b.update(pixels);
-#endif
-        }
-
-        if (c.open())
-        {
-#ifdef PIXELTOASTER_NO_STL
-            c.update(pixels.data());
-#else
-            c.update(pixels);
-#endif
-        }
+        group.update();
     }
 }
@@ -15,7 +15,28 @@
 #if PIXELTOASTER_PLATFORM == PIXELTOASTER_UNIX
 #    include "PixelToasterUnix.h"
 #    define TimerClass UnixTimer
-#    define DisplayClass UnixDisplay
+#    ifdef PIXELTOASTER_USE_XCB
+#        include "PixelToasterXcb.h"
+#        define DisplayClass XcbDisplay
+#    else
+#        define DisplayClass UnixDisplay
+#    endif
+
+// the static members of the unix platform live here, so the tests can include its header as well
+
+PixelToaster::UnixKeyMap::TKeyMap PixelToaster::UnixKeyMap::normalKeys_;
+PixelToaster::UnixKeyMap::TKeyMap PixelToaster::UnixKeyMap::functionKeys_;
+bool                              PixelToaster::UnixKeyMap::initialized_ = PixelToaster::UnixKeyMap::initialize();
+
+::Display* PixelToaster::UnixConnection::display_    = nullptr;
+int        PixelToaster::UnixConnection::references_ = 0;
+XContext   PixelToaster::UnixConnection::context_    = 0;
+Atom       PixelToaster::UnixConnection::atoms_[PixelToaster::UnixConnection::AtomCount];
+bool       PixelToaster::UnixConnection::remote_     = false;
+
+PixelToaster::UnixDisplay::CachedFrame PixelToaster::UnixDisplay::cache_[PixelToaster::UnixDisplay::cacheSize_];
+PixelToaster::integer32                PixelToaster::UnixDisplay::lastGeneration_ = 0;
+PixelToaster::UnixWorkerPool           PixelToaster::UnixDisplay::helpers_;
 #endif
 
 #if PIXELTOASTER_PLATFORM == PIXELTOASTER_APPLE
@@ -57,25 +78,64 @@ PIXELTOASTER_API PixelToaster::TimerInterface* PixelToaster::createTimer()
 #endif
 }
 
-PixelToaster::Converter_XBGRFFFF_to_XBGRFFFF converter_XBGRFFFF_to_XBGRFFFF;
-PixelToaster::Converter_XBGRFFFF_to_XRGB8888 converter_XBGRFFFF_to_XRGB8888;
-PixelToaster::Converter_XBGRFFFF_to_XBGR8888 converter_XBGRFFFF_to_XBGR8888;
-PixelToaster::Converter_XBGRFFFF_to_RGB888   converter_XBGRFFFF_to_RGB888;
-PixelToaster::Converter_XBGRFFFF_to_BGR888   converter_XBGRFFFF_to_BGR888;
-PixelToaster::Converter_XBGRFFFF_to_RGB565   converter_XBGRFFFF_to_RGB565;
-PixelToaster::Converter_XBGRFFFF_to_BGR565   converter_XBGRFFFF_to_BGR565;
-PixelToaster::Converter_XBGRFFFF_to_XRGB1555 converter_XBGRFFFF_to_XRGB1555;
-PixelToaster::Converter_XBGRFFFF_to_XBGR1555 converter_XBGRFFFF_to_XBGR1555;
-
-PixelToaster::Converter_XRGB8888_to_XBGRFFFF converter_XRGB8888_to_XBGRFFFF;
-PixelToaster::Converter_XRGB8888_to_XRGB8888 converter_XRGB8888_to_XRGB8888;
-PixelToaster::Converter_XRGB8888_to_XBGR8888 converter_XRGB8888_to_XBGR8888;
-PixelToaster::Converter_XRGB8888_to_RGB888   converter_XRGB8888_to_RGB888;
-PixelToaster::Converter_XRGB8888_to_BGR888   converter_XRGB8888_to_BGR888;
-PixelToaster::Converter_XRGB8888_to_RGB565   converter_XRGB8888_to_RGB565;
-PixelToaster::Converter_XRGB8888_to_BGR565   converter_XRGB8888_to_BGR565;
-PixelToaster::Converter_XRGB8888_to_XRGB1555 converter_XRGB8888_to_XRGB1555;
-PixelToaster::Converter_XRGB8888_to_XBGR1555 converter_XRGB8888_to_XBGR1555;
+PIXELTOASTER_API void PixelToaster::invalidateConversions(const void* pixels)
+{
+    DisplayClass::invalidate(pixels);
+}
+
+PIXELTOASTER_API bool PixelToaster::updateDisplays(PixelToaster::DisplayInterface* const displays[], const PixelToaster::TrueColorPixel* const trueColorPixels[], const PixelToaster::FloatingPointPixel* const floatingPointPixels[], int count)
+{
+    // note: every display was made by createDisplay, so they are all of the platform display class
+
+    return DisplayClass::updateGroup(displays, trueColorPixels, floatingPointPixels, count);
+}
+
+PIXELTOASTER_API void* PixelToaster::allocatePixels(PixelToaster::integer64 bytes)
+{
+    return DisplayClass::allocatePixels(bytes);
+}
+
+PIXELTOASTER_API void PixelToaster::freePixels(void* pixels)
+{
+    if (pixels)
+        DisplayClass::freePixels(pixels);
+}
+
+PixelToaster::Converter_XBGRFFFF_to_XBGRFFFF    converter_XBGRFFFF_to_XBGRFFFF;
+PixelToaster::Converter_XBGRFFFF_to_XRGB8888    converter_XBGRFFFF_to_XRGB8888;
+PixelToaster::Converter_XBGRFFFF_to_XBGR8888    converter_XBGRFFFF_to_XBGR8888;
+PixelToaster::Converter_XBGRFFFF_to_RGB888      converter_XBGRFFFF_to_RGB888;
+PixelToaster::Converter_XBGRFFFF_to_BGR888      converter_XBGRFFFF_to_BGR888;
+PixelToaster::Converter_XBGRFFFF_to_RGB565      converter_XBGRFFFF_to_RGB565;
+PixelToaster::Converter_XBGRFFFF_to_BGR565      converter_XBGRFFFF_to_BGR565;
+PixelToaster::Converter_XBGRFFFF_to_XRGB1555    converter_XBGRFFFF_to_XRGB1555;
+PixelToaster::Converter_XBGRFFFF_to_XBGR1555    converter_XBGRFFFF_to_XBGR1555;
+PixelToaster::Converter_XBGRFFFF_to_ARGB8888    converter_XBGRFFFF_to_ARGB8888;
+PixelToaster::Converter_XBGRFFFF_to_XRGB2101010 converter_XBGRFFFF_to_XRGB2101010;
+PixelToaster::Converter_XBGRFFFF_to_XBGR2101010 converter_XBGRFFFF_to_XBGR2101010;
+
+PixelToaster::Converter_XRGB8888_to_XBGRFFFF    converter_XRGB8888_to_XBGRFFFF;
+PixelToaster::Converter_XRGB8888_to_XRGB8888    converter_XRGB8888_to_XRGB8888;
+PixelToaster::Converter_XRGB8888_to_XBGR8888    converter_XRGB8888_to_XBGR8888;
+PixelToaster::Converter_XRGB8888_to_RGB888      converter_XRGB8888_to_RGB888;
+PixelToaster::Converter_XRGB8888_to_BGR888      converter_XRGB8888_to_BGR888;
+PixelToaster::Converter_XRGB8888_to_RGB565      converter_XRGB8888_to_RGB565;
+PixelToaster::Converter_XRGB8888_to_BGR565      converter_XRGB8888_to_BGR565;
+PixelToaster::Converter_XRGB8888_to_XRGB1555    converter_XRGB8888_to_XRGB1555;
+PixelToaster::Converter_XRGB8888_to_XBGR1555    converter_XRGB8888_to_XBGR1555;
+PixelToaster::Converter_XRGB8888_to_ARGB8888    converter_XRGB8888_to_ARGB8888;
+PixelToaster::Converter_XRGB8888_to_XRGB2101010 converter_XRGB8888_to_XRGB2101010;
+PixelToaster::Converter_XRGB8888_to_XBGR2101010 converter_XRGB8888_to_XBGR2101010;
+
+PixelToaster::Converter_XBGR8888_to_XRGB8888    converter_XBGR8888_to_XRGB8888;
+PixelToaster::Converter_RGB888_to_XRGB8888      converter_RGB888_to_XRGB8888;
+PixelToaster::Converter_BGR888_to_XRGB8888      converter_BGR888_to_XRGB8888;
+PixelToaster::Converter_RGB565_to_XRGB8888      converter_RGB565_to_XRGB8888;
+PixelToaster::Converter_BGR565_to_XRGB8888      converter_BGR565_to_XRGB8888;
+PixelToaster::Converter_XRGB1555_to_XRGB8888    converter_XRGB1555_to_XRGB8888;
+PixelToaster::Converter_XBGR1555_to_XRGB8888    converter_XBGR1555_to_XRGB8888;
+PixelToaster::Converter_XRGB2101010_to_XRGB8888 converter_XRGB2101010_to_XRGB8888;
+PixelToaster::Converter_XBGR2101010_to_XRGB8888 converter_XBGR2101010_to_XRGB8888;
 
 PIXELTOASTER_API PixelToaster::Converter* PixelToaster::requestConverter(PixelToaster::Format source, PixelToaster::Format destination)
 {
@@ -92,6 +152,9 @@ PIXELTOASTER_API PixelToaster::Converter* PixelToaster::requestConverter(PixelTo
             case Format::BGR565: return &converter_XBGRFFFF_to_BGR565;
             case Format::XRGB1555: return &converter_XBGRFFFF_to_XRGB1555;
             case Format::XBGR1555: return &converter_XBGRFFFF_to_XBGR1555;
+            case Format::ARGB8888: return &converter_XBGRFFFF_to_ARGB8888;
+            case Format::XRGB2101010: return &converter_XBGRFFFF_to_XRGB2101010;
+            case Format::XBGR2101010: return &converter_XBGRFFFF_to_XBGR2101010;
 
             default:
                 return nullptr;
@@ -110,6 +173,29 @@ PIXELTOASTER_API PixelToaster::Converter* PixelToaster::requestConverter(PixelTo
             case Format::BGR565: return &converter_XRGB8888_to_BGR565;
             case Format::XRGB1555: return &converter_XRGB8888_to_XRGB1555;
             case Format::XBGR1555: return &converter_XRGB8888_to_XBGR1555;
+            case Format::ARGB8888: return &converter_XRGB8888_to_ARGB8888;
+            case Format::XRGB2101010: return &converter_XRGB8888_to_XRGB2101010;
+            case Format::XBGR2101010: return &converter_XRGB8888_to_XBGR2101010;
+
+            default:
+                return nullptr;
+        }
+    }
+    else if (destination == Format::XRGB8888)
+    {
+        // note: other formats only convert to truecolor, convert through truecolor to get anything else
+
+        switch (source)
+        {
+            case Format::XBGR8888: return &converter_XBGR8888_to_XRGB8888;
+            case Format::RGB888: return &converter_RGB888_to_XRGB8888;
+            case Format::BGR888: return &converter_BGR888_to_XRGB8888;
+            case Format::RGB565: return &converter_RGB565_to_XRGB8888;
+            case Format::BGR565: return &converter_BGR565_to_XRGB8888;
+            case Format::XRGB1555: return &converter_XRGB1555_to_XRGB8888;
+            case Format::XBGR1555: return &converter_XBGR1555_to_XRGB8888;
+            case Format::XRGB2101010: return &converter_XRGB2101010_to_XRGB8888;
+            case Format::XBGR2101010: return &converter_XBGR2101010_to_XRGB8888;
 
             default:
                 return nullptr;
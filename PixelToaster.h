@@ -132,9 +132,10 @@ namespace PixelToaster {
 using std::vector;
 #endif
 
-using integer32 = unsigned int;   ///< unsigned 32 bit integer
-using integer16 = unsigned short; ///< unsigned 16 bit integer
-using integer8  = unsigned char;  ///< unsigned 8 bit integer
+using integer64 = unsigned long long; ///< unsigned 64 bit integer
+using integer32 = unsigned int;       ///< unsigned 32 bit integer
+using integer16 = unsigned short;     ///< unsigned 16 bit integer
+using integer8  = unsigned char;      ///< unsigned 8 bit integer
 
 /** \brief Represents a pixel in floating point color mode.
 
@@ -334,12 +335,13 @@ class Mode
 {
 public:
     /// The internal enumeration wrapped by the Mode class.
-    /// You should never need to use the enumeration type directly, only the Mode::TrueColor and Mode::FloatingPoint values.
+    /// You should never need to use the enumeration type directly, only the Mode::TrueColor, Mode::FloatingPoint and Mode::Indexed values.
 
     enum Enumeration
     {
-        TrueColor,    ///< pixels are represented as packed 32 bit integers. See TrueColorPixel for details.
-        FloatingPoint ///< pixels are represented by four floating point values for. See FloatingPointPixel for details.
+        TrueColor,     ///< pixels are represented as packed 32 bit integers. See TrueColorPixel for details.
+        FloatingPoint, ///< pixels are represented by four floating point values for. See FloatingPointPixel for details.
+        Indexed        ///< pixels are represented as 8 bit indices into the palette of the display. See Display::palette for details.
     };
 
     /// The mode default constuctor sets the enumeration value to FloatingPoint.
@@ -384,16 +386,23 @@ public:
 
     enum Enumeration
     {
-        Unknown,  ///< unknown pixel format.
-        XRGB8888, ///< 32 bit truecolor. this is the native pixel format in Mode::TrueColor.
-        XBGR8888, ///< 32 bit truecolor in BGR order.
-        RGB888,   ///< 24 bit truecolor.
-        BGR888,   ///< 24 bit truecolor in BGR order.
-        RGB565,   ///< 16 bit hicolor.
-        BGR565,   ///< 16 bit hicolor in BGR order.
-        XRGB1555, ///< 15 bit hicolor.
-        XBGR1555, ///< 15 bit hicolor in BGR order.
-        XBGRFFFF, ///< 128bit floating point color. this is the native pixel format in Mode::FloatingPoint.
+        Unknown,     ///< unknown pixel format.
+        XRGB8888,    ///< 32 bit truecolor. this is the native pixel format in Mode::TrueColor.
+        XBGR8888,    ///< 32 bit truecolor in BGR order.
+        RGB888,      ///< 24 bit truecolor.
+        BGR888,      ///< 24 bit truecolor in BGR order.
+        RGB565,      ///< 16 bit hicolor.
+        BGR565,      ///< 16 bit hicolor in BGR order.
+        XRGB1555,    ///< 15 bit hicolor.
+        XBGR1555,    ///< 15 bit hicolor in BGR order.
+        XBGRFFFF,    ///< 128bit floating point color. this is the native pixel format in Mode::FloatingPoint.
+        ARGB8888,    ///< 32 bit truecolor with premultiplied alpha in the high 8 bits. this is the native pixel format of translucent displays.
+        XRGB2101010, ///< 30 bit deep color, 10 bits per component.
+        XBGR2101010, ///< 30 bit deep color in BGR order.
+        Indexed8,    ///< 8 bit indices into the palette of the display. this is the pixel format in Mode::Indexed.
+        I420,        ///< 4:2:0 video. a luma plane followed by u and v planes of half the width and height.
+        NV12,        ///< 4:2:0 video. a luma plane followed by one plane of interleaved u and v of half the width and height.
+        YUY2,        ///< 4:2:2 video. one plane of pixel pairs packed as y0 u y1 v.
     };
 
     /// The default constructor sets the enumeration value to Unknown.
@@ -527,6 +536,229 @@ private:
     Enumeration enumeration;
 };
 
+/** \brief Lets you chose how updated frames are presented on the screen.
+
+		By default the display copies your pixels to the screen as soon as you call update, without any notion
+		of the monitor refresh. This is as fast as it gets, but the copy may happen while the monitor is scanning
+		out the previous frame, which shows up as tearing.
+
+		Vertical sync presentation queues each frame for the next vertical blank and makes Display::update wait until
+		the previous frame has actually been shown. This gives you tear-free output paced to the monitor refresh rate.
+
+		Immediate presentation shows each frame as soon as possible, like the default, but still reports
+		when each frame reached the screen via Display::timing.
+
+		Presentation modes other than default are only available on displays that support them,
+		other displays silently keep presenting in the default way.
+
+		\see Display::presentation and Display::timing
+	 **/
+
+class Presentation
+{
+public:
+    /// %Presentation enumeration.
+
+    enum Enumeration
+    {
+        Default,   ///< default presentation. copy pixels to the screen as soon as possible with no timing information.
+        Immediate, ///< present each frame as soon as possible and report when it reached the screen. may tear.
+        VSync      ///< present each frame at the next vertical blank and wait for the previous frame to be shown first. does not tear.
+    };
+
+    /// The default constructor sets the enumeration value to Default.
+
+    Presentation()
+    {
+        enumeration = Default;
+    }
+
+    /// This constructor enables automatic conversion from the enumeration type to a presentation object.
+    /// @param enumeration the enumeration value.
+
+    Presentation(Enumeration enumeration)
+    {
+        this->enumeration = enumeration;
+    }
+
+    /// Cast from presentation object to enumeration.
+    /// Allows you to treat this class as if it was the enumeration itself.
+    /// This enables the ==, != operators, and the use of presentation objects in a switch statement.
+
+    operator Enumeration() const
+    {
+        return enumeration;
+    }
+
+private:
+    Enumeration enumeration;
+};
+
+/** \brief Lets you chose how frames travel to a display on another machine.
+
+		Locally the display sends every frame whole, which is the fastest way to get pixels on the screen.
+		Over a network, for example X11 forwarded over ssh, whole frames quickly saturate the connection.
+
+		Remote transport splits each frame into tiles and only sends the tiles that changed since the frame
+		last sent, and keeps within the bandwidth budget set with Display::bandwidth by skipping updates
+		once the budget is spent. Displays updated together through a DisplayGroup send their frames the same way.
+
+		Automatic transport, the default, uses remote transport for displays that are connected over a network
+		and local transport otherwise. Displays that cannot tell or cannot send tiles always use local transport.
+
+		\see Display::transport and Display::bandwidth
+	 **/
+
+class Transport
+{
+public:
+    /// %Transport enumeration.
+
+    enum Enumeration
+    {
+        Automatic, ///< remote transport for displays connected over a network, local transport otherwise.
+        Local,     ///< send every frame whole.
+        Remote     ///< send only the tiles that changed, within the bandwidth budget.
+    };
+
+    /// The default constructor sets the enumeration value to Automatic.
+
+    Transport()
+    {
+        enumeration = Automatic;
+    }
+
+    /// This constructor enables automatic conversion from the enumeration type to a transport object.
+    /// @param enumeration the enumeration value.
+
+    Transport(Enumeration enumeration)
+    {
+        this->enumeration = enumeration;
+    }
+
+    /// Cast from transport object to enumeration.
+    /// Allows you to treat this class as if it was the enumeration itself.
+    /// This enables the ==, != operators, and the use of transport objects in a switch statement.
+
+    operator Enumeration() const
+    {
+        return enumeration;
+    }
+
+private:
+    Enumeration enumeration;
+};
+
+/** \brief Lets you chose how the luma and chroma of video frames map to color.
+
+		Video is stored as luma and chroma rather than as red, green and blue. Standard definition video uses
+		the BT.601 color space and high definition video the BT.709 color space, in the video range of
+		16 to 235 for luma and 16 to 240 for chroma. Pass the color space the frames were encoded in when you
+		update a display with video.
+
+		\see Display::update
+	 **/
+
+class ColorSpace
+{
+public:
+    /// %ColorSpace enumeration.
+
+    enum Enumeration
+    {
+        BT601, ///< standard definition video.
+        BT709  ///< high definition video.
+    };
+
+    /// The default constructor sets the enumeration value to BT601.
+
+    ColorSpace()
+    {
+        enumeration = BT601;
+    }
+
+    /// This constructor enables automatic conversion from the enumeration type to a color space object.
+    /// @param enumeration the enumeration value.
+
+    ColorSpace(Enumeration enumeration)
+    {
+        this->enumeration = enumeration;
+    }
+
+    /// Cast from color space object to enumeration.
+    /// Allows you to treat this class as if it was the enumeration itself.
+    /// This enables the ==, != operators, and the use of color space objects in a switch statement.
+
+    operator Enumeration() const
+    {
+        return enumeration;
+    }
+
+private:
+    Enumeration enumeration;
+};
+
+/** \brief Lets you trade a little accuracy in floating point conversion for speed.
+
+		Floating point pixels are converted to the format of the display exactly by default. Fast conversion
+		converts sixteen pixels at a time and may be one step of the display's format darker than exact
+		conversion, which is hard to see but makes updating floating point displays noticeably quicker.
+
+		Fast conversion needs SSE2. Without it, and for formats with alpha or with more than 8 bits per
+		component, floating point pixels are always converted exactly.
+
+		\see Display::quality
+	 **/
+
+class Quality
+{
+public:
+    /// %Quality enumeration.
+
+    enum Enumeration
+    {
+        Exact, ///< convert floating point pixels exactly.
+        Fast   ///< convert floating point pixels quickly, at most one step off.
+    };
+
+    /// The default constructor sets the enumeration value to Exact.
+
+    Quality()
+    {
+        enumeration = Exact;
+    }
+
+    /// This constructor enables automatic conversion from the enumeration type to a quality object.
+    /// @param enumeration the enumeration value.
+
+    Quality(Enumeration enumeration)
+    {
+        this->enumeration = enumeration;
+    }
+
+    /// Cast from quality object to enumeration.
+    /// Allows you to treat this class as if it was the enumeration itself.
+    /// This enables the ==, != operators, and the use of quality objects in a switch statement.
+
+    operator Enumeration() const
+    {
+        return enumeration;
+    }
+
+private:
+    Enumeration enumeration;
+};
+
+/// Describes when a frame actually reached the screen.
+/// \see Display::timing
+
+struct Timing
+{
+    double    time;   ///< time in seconds at which the frame was shown, measured by the display server's monotonic clock.
+    integer64 msc;    ///< media stamp counter, the number of vertical blanks at which the frame was shown.
+    integer32 serial; ///< number of the update that produced the frame, counting from one since the display was opened.
+};
+
 /** \brief Describes the current mouse position and the state of the left, right and middle mouse buttons.
 
 		This class is used by the Listener interface for each of the event callbacks for mouse input.
@@ -761,11 +993,44 @@ struct Rectangle
     }
 };
 
+/** \brief An input event.
+
+		Displays can put their input events in a queue as well as passing them to the listener, see Display::queueEvents.
+		This lets another thread, for example a simulation running at its own rate, take the events out with
+		Display::pollEvent instead of handling them in listener callbacks on the thread that updates the display.
+	 **/
+
+struct Event
+{
+    /// The kind of event.
+
+    enum Type
+    {
+        KeyDown,         ///< a key was pressed. see key.
+        KeyUp,           ///< a key was released. see key.
+        MouseButtonDown, ///< a mouse button was pressed. see mouse.
+        MouseButtonUp,   ///< a mouse button was released. see mouse.
+        MouseMove,       ///< the mouse was moved. see mouse.
+        Activate,        ///< the display window was activated or deactivated. see active.
+        Close            ///< the user asked to close the display window.
+    };
+
+    Type   type;   ///< the kind of event.
+    double time;   ///< time in seconds at which the display received the event. only meaningful relative to other events of the same display.
+    Key    key;    ///< the key, for key events.
+    Mouse  mouse;  ///< the mouse event data, for mouse events.
+    bool   active; ///< true if the window was activated, false if it was deactivated, for activate events.
+};
+
 // internal factory methods
 
 PIXELTOASTER_API class DisplayInterface* createDisplay();
 PIXELTOASTER_API class TimerInterface*   createTimer();
 PIXELTOASTER_API class Converter*        requestConverter(Format source, Format destination);
+PIXELTOASTER_API void                    invalidateConversions(const void* pixels);
+PIXELTOASTER_API bool                    updateDisplays(class DisplayInterface* const displays[], const TrueColorPixel* const trueColorPixels[], const FloatingPointPixel* const floatingPointPixels[], int count);
+PIXELTOASTER_API void*                   allocatePixels(integer64 bytes);
+PIXELTOASTER_API void                    freePixels(void* pixels);
 
 // internal display interface
 
@@ -781,6 +1046,12 @@ public:
 
     virtual bool update(const FloatingPointPixel pixels[], const Rectangle* dirtyBox = nullptr) = 0;
     virtual bool update(const TrueColorPixel pixels[], const Rectangle* dirtyBox = nullptr)     = 0;
+    virtual bool update(const void* pixels, Format format, const Rectangle* dirtyBox = nullptr) = 0;
+    virtual bool update(const void* canvas, Format format, int pitch, int x, int y, const Rectangle* dirtyBox = nullptr) = 0;
+    virtual bool scroll(int dx, int dy, const void* pixels, Format format) = 0;
+    virtual bool update(const void* const planes[], const int pitches[], Format format, ColorSpace colorSpace = ColorSpace::BT601, const Rectangle* dirtyBox = nullptr) = 0;
+
+    virtual Format format() const = 0;
 
     virtual const char* title() const             = 0;
     virtual void        title(const char title[]) = 0;
@@ -794,6 +1065,39 @@ public:
 
     virtual void              wrapper(DisplayInterface* wrapper) = 0;
     virtual DisplayInterface* wrapper()                          = 0;
+
+    virtual void bandHeight(int rows) = 0;
+    virtual int  bandHeight() const   = 0;
+
+    virtual void coalesceMouseMotion(bool coalesce) = 0;
+    virtual bool coalesceMouseMotion() const        = 0;
+
+    virtual void resizable(bool resizable) = 0;
+    virtual bool resizable() const         = 0;
+
+    virtual void translucent(bool translucent) = 0;
+    virtual bool translucent() const           = 0;
+
+    virtual void                  palette(const TrueColorPixel colors[], int first = 0, int count = 256) = 0;
+    virtual const TrueColorPixel* palette() const                                                        = 0;
+
+    virtual void    quality(Quality quality) = 0;
+    virtual Quality quality() const          = 0;
+
+    virtual void queueEvents(bool queue)  = 0;
+    virtual bool queueEvents() const      = 0;
+    virtual bool pollEvent(Event& event) = 0;
+
+    virtual void         presentation(Presentation presentation) = 0;
+    virtual Presentation presentation() const                    = 0;
+    virtual bool         timing(Timing& timing) const            = 0;
+
+    virtual void      transport(Transport transport) = 0;
+    virtual Transport transport() const              = 0;
+    virtual void      bandwidth(int bytesPerSecond)  = 0;
+    virtual int       bandwidth() const              = 0;
+
+    virtual bool waitEvents(double timeout) = 0;
 };
 
 /** \brief Provides the mechanism for getting your pixels up on the screen.
@@ -888,6 +1192,8 @@ public:
     /// @param output the output type of the display. you can choose between windowed output and fullscreen output, or you can leave it up to the display by passing in default.
     /// @param mode the mode of operation for the display. you can choose between true color mode and floating point color mode.
     /// @returns true if the display open was successful.
+    /// Opening a display that is already open with the same output and mode just changes its title and size.
+    /// Displays that support it keep their window and buffers for this instead of closing and opening again.
 
     bool open(const char title[], int width, int height, Output output = Output::Default, Mode mode = Mode::FloatingPoint) override
     {
@@ -967,6 +1273,116 @@ public:
             return false;
     }
 
+    /// Update display with 8 bit palette indices.
+    /// The input indices must be a linear array of size width x height, just like truecolor pixels.
+    /// Each index shows the color of that entry of the palette, see Display::palette.
+    /// This is the natural update method to call when the display was opened in Mode::Indexed,
+    /// and works just like updating with pixels in Format::Indexed8.
+    /// @param indices the palette indices to show on the screen.
+    /// @param dirtyBox range of pixels that have been changed since last call.
+    /// @returns true if the update was successful.
+
+    bool update(const integer8 indices[], const Rectangle* dirtyBox = nullptr)
+    {
+        return update(indices, Format::Indexed8, dirtyBox);
+    }
+
+    /// Update display with pixels in any format.
+    /// The input pixels must be a linear array of width x height pixels in the given format, packed without padding between rows.
+    /// Pixels in the native format of the display, see Display::format, go to the screen without any conversion,
+    /// so renderers that can just as easily produce that format should. Pixels in other formats are converted.
+    /// The dirty box is a hint, just like for the other update methods.
+    /// @param pixels the pixels to copy to the screen.
+    /// @param format the pixel format of the pixels.
+    /// @param dirtyBox range of pixels that have been changed since last call.
+    /// @returns true if the update was successful, false if the display cannot show pixels in this format.
+
+    bool update(const void* pixels, Format format, const Rectangle* dirtyBox = nullptr) override
+    {
+        if (internal)
+            return internal->update(pixels, format, dirtyBox);
+        else
+            return false;
+    }
+
+    /// Update display with a viewport into a larger canvas of pixels.
+    /// The viewport is a rectangle of width x height pixels of the canvas, where width and height are the dimensions of the display.
+    /// Use this when you render into something bigger than the display, such as a scrolling canvas, to show part of it
+    /// without copying that part out first. Displays read the viewport in place wherever they can.
+    /// @param canvas the first pixel of the canvas.
+    /// @param format the pixel format of the canvas, for example Format::XRGB8888 for truecolor pixels.
+    /// @param pitch the number of bytes from the start of one row of the canvas to the start of the next.
+    /// @param x the column of the canvas that is the left edge of the viewport.
+    /// @param y the row of the canvas that is the top edge of the viewport.
+    /// @param dirtyBox range of pixels of the viewport that have been changed since last call.
+    /// @returns true if the update was successful, false if the display cannot show pixels in this format.
+
+    bool update(const void* canvas, Format format, int pitch, int x, int y, const Rectangle* dirtyBox = nullptr) override
+    {
+        if (internal)
+            return internal->update(canvas, format, pitch, x, y, dirtyBox);
+        else
+            return false;
+    }
+
+    /// Scroll the display contents and update the part scrolled into view.
+    /// Moves what the display shows by dx pixels to the right and dy pixels down, then updates only the strips
+    /// uncovered along the edges from the new frame. This is much cheaper than a full update for views that move
+    /// a few pixels each frame, such as logs and waveforms, because the pixels that stay in view are moved by
+    /// the display without being converted or sent to the screen again. Displays that cannot move their contents
+    /// do a full update instead, so the new frame must still be complete.
+    /// @param dx the number of pixels to move the contents right, negative to move them left.
+    /// @param dy the number of pixels to move the contents down, negative to move them up.
+    /// @param pixels the whole new frame, width x height pixels packed without padding between rows.
+    /// @param format the pixel format of the pixels.
+    /// @returns true if the update was successful, false if the display cannot show pixels in this format.
+
+    bool scroll(int dx, int dy, const void* pixels, Format format) override
+    {
+        if (internal)
+            return internal->scroll(dx, dy, pixels, format);
+        else
+            return false;
+    }
+
+    /// Update display with a frame of video.
+    /// Video formats store luma for each pixel and chroma shared by neighboring pixels, in one or more planes.
+    /// Format::I420 has three planes: luma, u and v. Format::NV12 has two: luma, and u and v interleaved.
+    /// Format::YUY2 has one plane of luma and chroma packed together. Displays convert the frame straight to
+    /// their native format, spreading each chroma sample over the pixels that share it as they go.
+    /// Frames packed without padding in one block of memory, with the planes one after the other, can also be
+    /// passed to the update method that takes pixels in any format, which takes them to be in ColorSpace::BT601.
+    /// @param planes the first byte of each plane.
+    /// @param pitches the number of bytes from the start of one row of each plane to the start of the next.
+    /// @param format the video format of the frame, Format::I420, Format::NV12 or Format::YUY2.
+    /// @param colorSpace the color space the frame was encoded in.
+    /// @param dirtyBox range of pixels that have been changed since last call.
+    /// @returns true if the update was successful, false if the display cannot show video in this format.
+
+    bool update(const void* const planes[], const int pitches[], Format format, ColorSpace colorSpace = ColorSpace::BT601, const Rectangle* dirtyBox = nullptr) override
+    {
+        if (internal)
+            return internal->update(planes, pitches, format, colorSpace, dirtyBox);
+        else
+            return false;
+    }
+
+    /// Scroll the display contents and update the part scrolled into view from floating point pixels.
+    /// Works just like scrolling with pixels in Format::XBGRFFFF.
+
+    bool scroll(int dx, int dy, const FloatingPointPixel pixels[])
+    {
+        return scroll(dx, dy, pixels, Format::XBGRFFFF);
+    }
+
+    /// Scroll the display contents and update the part scrolled into view from truecolor pixels.
+    /// Works just like scrolling with pixels in Format::XRGB8888.
+
+    bool scroll(int dx, int dy, const TrueColorPixel pixels[])
+    {
+        return scroll(dx, dy, pixels, Format::XRGB8888);
+    }
+
 #ifndef PIXELTOASTER_NO_STL
 
     /// Update display with standard vector of floating point pixels.
@@ -989,6 +1405,16 @@ public:
         return update(pixels.data(), dirtyBox);
     }
 
+    /// Update display with standard vector of palette indices.
+    /// This is just a helper method to make it a bit cleaner to pass a vector of indices into the update.
+    /// @param indices the palette indices to show on the screen.
+    /// @returns true if the update was successful.
+
+    bool update(const vector<integer8>& indices, const Rectangle* dirtyBox = nullptr)
+    {
+        return update(indices.data(), dirtyBox);
+    }
+
 #endif
 
     /// Get display title
@@ -1049,6 +1475,18 @@ public:
             return Output::Default;
     }
 
+    /// Get native pixel format.
+    /// This is the format the display shows pixels in. Pixels passed to Display::update in this format need no conversion.
+    /// @returns the native pixel format of the open display, or Format::Unknown if the display is not open or does not know it.
+
+    Format format() const override
+    {
+        if (internal)
+            return internal->format();
+        else
+            return Format::Unknown;
+    }
+
     /// Register a listener object.
     /// Implement the Listener interface and pass in an pointer to an instance of your object to recieve display events such as keyboard and mouse input.
     ///	@param listener the listener object. pass in 0 if you want to remove the current listener.
@@ -1080,10 +1518,567 @@ public:
         return this;
     }
 
+    /// Set update band height.
+    /// Displays that need to convert your pixels before sending them to the screen may split each update into
+    /// horizontal bands of this many rows, so that converting one band overlaps with transferring the previous one.
+    /// The setting persists across calls to Display::open and Display::close.
+    /// @param rows the number of rows per band. pass in 0 to update the whole display in a single band.
+
+    void bandHeight(int rows) override
+    {
+        if (internal)
+            internal->bandHeight(rows);
+    }
+
+    /// Get update band height.
+    /// @returns the number of rows per band, or 0 if updates are not split into bands.
+
+    int bandHeight() const override
+    {
+        if (internal)
+            return internal->bandHeight();
+        else
+            return 0;
+    }
+
+    /// Set mouse motion coalescing.
+    /// By default the listener gets a Listener::onMouseMove call for every mouse move the window system reports,
+    /// which can be hundreds per frame with high rate mice. When coalescing, consecutive mouse moves are collected
+    /// instead and delivered as a single Listener::onMouseMotion call with all the samples, followed by a single
+    /// Listener::onMouseMove call with the latest position.
+    /// The setting persists across calls to Display::open and Display::close.
+    /// Displays that cannot coalesce mouse motion keep sending every move.
+    /// @param coalesce true to coalesce mouse motion.
+
+    void coalesceMouseMotion(bool coalesce) override
+    {
+        if (internal)
+            internal->coalesceMouseMotion(coalesce);
+    }
+
+    /// Check if mouse motion is coalesced.
+    /// @returns true if mouse motion coalescing was requested.
+
+    bool coalesceMouseMotion() const override
+    {
+        if (internal)
+            return internal->coalesceMouseMotion();
+        else
+            return false;
+    }
+
+    /// Set window resizing.
+    /// By default the user cannot resize a display window. When resizable, the listener gets a Listener::onResize
+    /// call each time the user resizes the window, and decides whether the display takes the size of the window.
+    /// The setting persists across calls to Display::open and Display::close, and takes effect on the next open.
+    /// Displays that cannot resize their window ignore it.
+    /// @param resizable true to let the user resize the window.
+
+    void resizable(bool resizable) override
+    {
+        if (internal)
+            internal->resizable(resizable);
+    }
+
+    /// Check if the window is resizable.
+    /// @returns true if a resizable window was requested.
+
+    bool resizable() const override
+    {
+        if (internal)
+            return internal->resizable();
+        else
+            return false;
+    }
+
+    /// Set window translucency.
+    /// A translucent display shows the desktop behind its window wherever the pixels are not opaque. The alpha
+    /// of floating point and truecolor pixels becomes their opacity, from 0 for invisible to 1.0 or 255 for opaque,
+    /// so make sure to set it. Pixels in formats without alpha are opaque. The native format of a translucent
+    /// display is Format::ARGB8888, which takes premultiplied pixels as they are.
+    /// The setting persists across calls to Display::open and Display::close, and takes effect on the next open.
+    /// Translucency needs a compositing desktop, displays that cannot be translucent stay opaque and ignore alpha.
+    /// @param translucent true to make the window translucent.
+
+    void translucent(bool translucent) override
+    {
+        if (internal)
+            internal->translucent(translucent);
+    }
+
+    /// Check if the window is translucent.
+    /// @returns true if a translucent window was requested.
+
+    bool translucent() const override
+    {
+        if (internal)
+            return internal->translucent();
+        else
+            return false;
+    }
+
+    /// Set palette colors.
+    /// Palette indices passed to Display::update show the color of their entry of the palette, which starts out as
+    /// a gray ramp from black at index 0 to white at index 255. Displays keep the palette converted to their native
+    /// format, so changing it costs converting the changed entries only, no matter the size of the display, and
+    /// the next update shows the indices with the new colors. Change just a few entries for palette animation.
+    /// The setting persists across calls to Display::open and Display::close.
+    /// @param colors the new colors of the entries.
+    /// @param first the index of the first entry to change.
+    /// @param count the number of entries to change, entries beyond index 255 are ignored.
+
+    void palette(const TrueColorPixel colors[], int first = 0, int count = 256) override
+    {
+        if (internal)
+            internal->palette(colors, first, count);
+    }
+
+    /// Get palette colors.
+    /// @returns the 256 entries of the palette, null if there is no display.
+
+    const TrueColorPixel* palette() const override
+    {
+        if (internal)
+            return internal->palette();
+        else
+            return nullptr;
+    }
+
+    /// Set floating point conversion quality.
+    /// Fast conversion of floating point pixels is quicker but may be one step of the display's format off.
+    /// The setting persists across calls to Display::open and Display::close. Displays that cannot convert
+    /// quickly ignore it and convert exactly.
+    /// @param quality the conversion quality.
+
+    void quality(Quality quality) override
+    {
+        if (internal)
+            internal->quality(quality);
+    }
+
+    /// Get floating point conversion quality.
+    /// @returns the requested conversion quality.
+
+    Quality quality() const override
+    {
+        if (internal)
+            return internal->quality();
+        else
+            return Quality::Exact;
+    }
+
+    /// Set input event queueing.
+    /// When queueing, the display puts each input event in a queue in addition to passing it to the listener.
+    /// The events are still received while the display is updated or waits for events, but they can be taken out
+    /// of the queue with Display::pollEvent on any one thread, so input handling no longer has to happen on the
+    /// thread that updates the display. The queue is lock free and holds 256 events without ever allocating memory,
+    /// further events are dropped until the queue is polled again.
+    /// The setting persists across calls to Display::open and Display::close. Displays that cannot queue events ignore it.
+    /// @param queue true to queue input events.
+
+    void queueEvents(bool queue) override
+    {
+        if (internal)
+            internal->queueEvents(queue);
+    }
+
+    /// Check if input events are queued.
+    /// @returns true if input event queueing was requested.
+
+    bool queueEvents() const override
+    {
+        if (internal)
+            return internal->queueEvents();
+        else
+            return false;
+    }
+
+    /// Take the oldest input event out of the queue.
+    /// Only call this from one thread at a time. See Display::queueEvents.
+    /// @param event receives the event.
+    /// @returns true if there was an event, false if the queue is empty.
+
+    bool pollEvent(Event& event) override
+    {
+        if (internal)
+            return internal->pollEvent(event);
+        else
+            return false;
+    }
+
+    /// Set presentation mode.
+    /// Takes effect on the next update, and persists across calls to Display::open and Display::close.
+    /// Displays that cannot present in the requested way keep presenting in the default way.
+    /// @param presentation the presentation mode.
+
+    void presentation(Presentation presentation) override
+    {
+        if (internal)
+            internal->presentation(presentation);
+    }
+
+    /// Get presentation mode.
+    /// @returns the presentation mode most recently requested.
+
+    Presentation presentation() const override
+    {
+        if (internal)
+            return internal->presentation();
+        else
+            return Presentation::Default;
+    }
+
+    /// Get timing of the most recently shown frame.
+    /// Only available while presenting in Presentation::Immediate or Presentation::VSync mode on displays that support it.
+    /// @param timing receives the time, vertical blank count and update serial of the frame.
+    /// @returns true if timing is available, false otherwise.
+
+    bool timing(Timing& timing) const override
+    {
+        if (internal)
+            return internal->timing(timing);
+        else
+            return false;
+    }
+
+    /// Set transport.
+    /// Takes effect on the next update, and persists across calls to Display::open and Display::close.
+    /// Displays that cannot send frames in tiles always send them whole.
+    /// @param transport the transport.
+
+    void transport(Transport transport) override
+    {
+        if (internal)
+            internal->transport(transport);
+    }
+
+    /// Get transport.
+    /// @returns the transport most recently requested.
+
+    Transport transport() const override
+    {
+        if (internal)
+            return internal->transport();
+        else
+            return Transport::Automatic;
+    }
+
+    /// Set bandwidth budget for remote transport.
+    /// While sending frames in tiles, the display skips updates whenever the bytes it sent would exceed this
+    /// many bytes per second, which lowers the update rate until the frames fit. The changes of skipped updates
+    /// are not lost, they are sent with the next update that fits the budget.
+    /// The setting persists across calls to Display::open and Display::close.
+    /// @param bytesPerSecond the budget in bytes per second. pass in 0 to send every update.
+
+    void bandwidth(int bytesPerSecond) override
+    {
+        if (internal)
+            internal->bandwidth(bytesPerSecond);
+    }
+
+    /// Get bandwidth budget for remote transport.
+    /// @returns the budget in bytes per second, or 0 if there is no budget.
+
+    int bandwidth() const override
+    {
+        if (internal)
+            return internal->bandwidth();
+        else
+            return 0;
+    }
+
+    /// Wait for events.
+    /// Blocks until input arrives or the timeout expires, then passes the events on to the listener just like Display::update does.
+    /// Use this instead of updating continuously in applications that only redraw in response to input, so an idle display costs no cpu.
+    /// Displays sharing a connection to the window system may also receive their events while this display waits.
+    /// On platforms that cannot wait for events this returns false immediately.
+    /// @param timeout the maximum time to wait in seconds, or a negative value to wait until events arrive.
+    /// @returns true if events were processed, false if the timeout expired or the display is not open.
+
+    bool waitEvents(double timeout = -1.0) override
+    {
+        if (internal)
+            return internal->waitEvents(timeout);
+        else
+            return false;
+    }
+
+    /// Invalidate shared pixel conversions.
+    /// When several displays are updated with the same pixels and need them in the same format, the pixels are
+    /// converted once and the result is shared. A new frame is assumed to begin when a display is updated again
+    /// with pixels it has already shown, so the common case of updating each display once per frame just works.
+    /// If you change the pixels between updating two displays within one frame, for example because you render
+    /// different images into one scratch array, call this after changing them so the next display converts again.
+    /// @param pixels the pixel array that changed, or null to invalidate all shared conversions.
+
+    static void invalidate(const void* pixels = nullptr)
+    {
+        invalidateConversions(pixels);
+    }
+
 private:
+    friend class DisplayGroup;
+
     DisplayInterface* internal;
 };
 
+/** \brief Updates several displays in one go.
+
+		Updating displays one after another converts, sends and flushes each frame on its own.
+		A display group instead converts the pixels of all its displays in parallel where the platform
+		supports it, then sends all the frames to the screen together and processes events once.
+
+		\code
+
+Display a( "A", 320, 240 );
+Display b( "B", 320, 240 );
+
+vector<Pixel> pixelsA( 320 * 240 );
+vector<Pixel> pixelsB( 320 * 240 );
+
+DisplayGroup group;
+group.add( a, pixelsA );
+group.add( b, pixelsB );
+
+while ( a.open() || b.open() )
+{
+	// render into pixelsA and pixelsB...
+
+	group.update();
+}
+
+		\endcode
+
+		The group only keeps pointers to the displays and pixels, so they must stay alive while they are in the group.
+	 **/
+
+class DisplayGroup
+{
+public:
+    /// Maximum number of displays in a group.
+
+    enum
+    {
+        MaximumDisplays = 64
+    };
+
+    /// Creates an empty group.
+
+    DisplayGroup()
+    {
+        count = 0;
+    }
+
+    /// Add a display updated with floating point pixels.
+    /// @param display the display to add.
+    /// @param pixels the pixels copied to the display on each update, see Display::update.
+    /// @returns true if the display was added, false if the group is full.
+
+    bool add(Display& display, const FloatingPointPixel pixels[])
+    {
+        return add(display, nullptr, pixels);
+    }
+
+    /// Add a display updated with truecolor pixels.
+    /// @param display the display to add.
+    /// @param pixels the pixels copied to the display on each update, see Display::update.
+    /// @returns true if the display was added, false if the group is full.
+
+    bool add(Display& display, const TrueColorPixel pixels[])
+    {
+        return add(display, pixels, nullptr);
+    }
+
+#ifndef PIXELTOASTER_NO_STL
+
+    /// Add a display updated with a standard vector of floating point pixels.
+    /// The vector must not be resized while the display is in the group.
+
+    bool add(Display& display, const vector<FloatingPointPixel>& pixels)
+    {
+        return add(display, pixels.data());
+    }
+
+    /// Add a display updated with a standard vector of truecolor pixels.
+    /// The vector must not be resized while the display is in the group.
+
+    bool add(Display& display, const vector<TrueColorPixel>& pixels)
+    {
+        return add(display, pixels.data());
+    }
+
+#endif
+
+    /// Remove all displays from the group.
+
+    void clear()
+    {
+        count = 0;
+    }
+
+    /// Get the number of displays in the group.
+
+    int size() const
+    {
+        return count;
+    }
+
+    /// Update all open displays in the group.
+    /// Displays that are not open are skipped.
+    /// @returns true if all open displays were updated successfully.
+
+    bool update()
+    {
+        DisplayInterface*         openDisplays[MaximumDisplays];
+        const TrueColorPixel*     openTrueColorPixels[MaximumDisplays];
+        const FloatingPointPixel* openFloatingPointPixels[MaximumDisplays];
+
+        int openCount = 0;
+
+        for (int i = 0; i < count; ++i)
+        {
+            if (displays[i]->internal && displays[i]->open())
+            {
+                openDisplays[openCount]            = displays[i]->internal;
+                openTrueColorPixels[openCount]     = trueColorPixels[i];
+                openFloatingPointPixels[openCount] = floatingPointPixels[i];
+                openCount++;
+            }
+        }
+
+        return updateDisplays(openDisplays, openTrueColorPixels, openFloatingPointPixels, openCount);
+    }
+
+private:
+    bool add(Display& display, const TrueColorPixel* trueColor, const FloatingPointPixel* floatingPoint)
+    {
+        if (count == MaximumDisplays)
+            return false;
+
+        displays[count]            = &display;
+        trueColorPixels[count]     = trueColor;
+        floatingPointPixels[count] = floatingPoint;
+        count++;
+        return true;
+    }
+
+    Display*                  displays[MaximumDisplays];
+    const TrueColorPixel*     trueColorPixels[MaximumDisplays];
+    const FloatingPointPixel* floatingPointPixels[MaximumDisplays];
+    int                       count;
+};
+
+/** \brief Holds the pixels of a frame in memory laid out for fast updates.
+
+		A frame buffer is an array of pixels, like a vector of pixels, but the memory comes from the library
+		instead of the standard allocator. It is aligned to 64 bytes, the size of a cache line and of the
+		widest simd registers, so the pixel converters never have to deal with pixels straddling either.
+		On platforms that support it, frames of a few megabytes and up are also backed by huge pages.
+		Every update walks through the whole frame, and with huge pages that takes a handful of tlb
+		entries instead of hundreds, so the walk spends less time waiting on page table lookups.
+
+		\code
+
+FrameBuffer<Pixel> pixels( width * height );
+
+while ( display.open() )
+{
+	pixels[x+y*width].b = 1.0f;
+
+	display.update( pixels.data() );
+}
+
+		\endcode
+
+		Frame buffers cannot be copied. The pixels start out black, just like in a vector of pixels.
+	 **/
+
+template <typename T>
+class FrameBuffer
+{
+public:
+    /// Creates an empty frame buffer.
+
+    FrameBuffer()
+    {
+        pixels = nullptr;
+        count  = 0;
+    }
+
+    /// Creates a frame buffer of the given number of pixels.
+    /// @param count the number of pixels, usually the width times the height of the display.
+
+    explicit FrameBuffer(int count)
+    {
+        pixels      = nullptr;
+        this->count = 0;
+        resize(count);
+    }
+
+    ~FrameBuffer()
+    {
+        freePixels(pixels);
+    }
+
+    /// Change the number of pixels.
+    /// The pixels are not kept, they are all black again afterwards.
+    /// @param count the new number of pixels.
+    /// @returns true if successful, false if there is not enough memory, in which case the frame buffer is empty.
+
+    bool resize(int count)
+    {
+        freePixels(pixels);
+
+        pixels      = count > 0 ? static_cast<T*>(allocatePixels(static_cast<integer64>(count) * sizeof(T))) : nullptr;
+        this->count = pixels ? count : 0;
+
+        for (int i = 0; i < this->count; ++i)
+            pixels[i] = T();
+
+        return this->count == count || count <= 0;
+    }
+
+    /// Get the number of pixels.
+
+    int size() const
+    {
+        return count;
+    }
+
+    /// Get the pixels, to pass to Display::update.
+    /// @returns the pixels, null if the frame buffer is empty.
+
+    T* data()
+    {
+        return pixels;
+    }
+
+    const T* data() const
+    {
+        return pixels;
+    }
+
+    /// Access a pixel.
+    /// @param index the index of the pixel, as in the linear array passed to Display::update.
+
+    T& operator[](int index)
+    {
+        return pixels[index];
+    }
+
+    const T& operator[](int index) const
+    {
+        return pixels[index];
+    }
+
+private:
+    FrameBuffer(const FrameBuffer&) = delete;
+    FrameBuffer& operator=(const FrameBuffer&) = delete;
+
+    T*  pixels;
+    int count;
+};
+
 // internal timer interface
 
 class TimerInterface
@@ -1376,6 +2371,17 @@ public:
 
     virtual void onMouseMove(DisplayInterface& display, Mouse mouse) {}
 
+    /// On coalesced mouse motion.
+    /// Called instead of one Listener::onMouseMove per move when the display coalesces mouse motion,
+    /// see Display::coalesceMouseMotion. It is followed by one call to Listener::onMouseMove with the latest position.
+    /// @param display the display sending the event
+    /// @param samples the mouse event data of each move in the order they happened, the last one is the latest position.
+    /// @param count the number of moves, at least one.
+    /// @param dx the horizontal distance moved since the latest position of the previous call.
+    /// @param dy the vertical distance moved since the latest position of the previous call.
+
+    virtual void onMouseMotion(DisplayInterface& display, const Mouse samples[], int count, float dx, float dy) {}
+
     /// On activate.
     /// Called when the display window is activated or deactivated.
     /// @param display the display sending the event
@@ -1383,6 +2389,16 @@ public:
 
     virtual void onActivate(DisplayInterface& display, bool active) {}
 
+    /// On resize.
+    /// Called when the user resized a resizable display window, see Display::resizable.
+    /// If you return true, the display takes the new size and expects pixels of that size from the next update on.
+    /// If you return false, the display keeps its size and shows the pixels in the middle of the window. false is default.
+    /// @param display the display sending the event
+    /// @param width the new width of the window in pixels.
+    /// @param height the new height of the window in pixels.
+
+    virtual bool onResize(DisplayInterface& display, int width, int height) { return false; }
+
     /// On open.
     /// Called when a display is opened successfully.
     /// @param display the display sending the event
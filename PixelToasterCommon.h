@@ -4,6 +4,13 @@
 
 #ifndef PIXELTOASTER_NO_CRT
 #    include <ctime>
+#    include <stdlib.h>
+#endif
+
+#include "PixelToasterConversion.h"
+
+#ifdef _MSC_VER
+#    include <intrin.h>
 #endif
 
 namespace PixelToaster {
@@ -22,6 +29,85 @@ inline void magical_strcpy(char (&dest)[n], const char src[])
     dest[i] = 0;
 }
 
+// the atomics the event queue needs, without pulling in the standard library
+
+#ifdef _MSC_VER
+
+inline integer32 loadAcquire(integer32* value)
+{
+    return static_cast<integer32>(_InterlockedOr(reinterpret_cast<volatile long*>(value), 0));
+}
+
+inline void storeRelease(integer32* value, integer32 x)
+{
+    _InterlockedExchange(reinterpret_cast<volatile long*>(value), static_cast<long>(x));
+}
+
+#else
+
+inline integer32 loadAcquire(integer32* value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+inline void storeRelease(integer32* value, integer32 x)
+{
+    __atomic_store_n(value, x, __ATOMIC_RELEASE);
+}
+
+#endif
+
+// lock free queue of input events, with one thread pushing and one thread popping.
+// head and tail only ever grow and wrap around naturally, their difference is the number of queued events.
+
+class EventQueue
+{
+public:
+    EventQueue()
+    {
+        _head = 0;
+        _tail = 0;
+    }
+
+    // called by the thread that pumps the display events only
+
+    bool push(const Event& event)
+    {
+        const integer32 tail = _tail;
+        if (tail - loadAcquire(&_head) == capacity)
+            return false;
+
+        _events[tail & (capacity - 1)] = event;
+        storeRelease(&_tail, tail + 1);
+        return true;
+    }
+
+    // called by the polling thread only
+
+    bool pop(Event& event)
+    {
+        const integer32 head = _head;
+        if (loadAcquire(&_tail) == head)
+            return false;
+
+        event = _events[head & (capacity - 1)];
+        storeRelease(&_head, head + 1);
+        return true;
+    }
+
+private:
+    enum
+    {
+        capacity  = 256, // must be a power of two
+        cacheLine = 64
+    };
+
+    Event     _events[capacity];
+    integer32 _head; ///< next event to pop, written by the polling thread
+    char      _padding[cacheLine - sizeof(integer32)];
+    integer32 _tail; ///< next slot to push, written by the pumping thread
+};
+
 // derive your platform's display implementation from this and it will handle all the mundane details for you
 
 class DisplayAdapter : public DisplayInterface
@@ -29,8 +115,19 @@ class DisplayAdapter : public DisplayInterface
 public:
     DisplayAdapter()
     {
-        _listener = nullptr;
-        _wrapper  = nullptr;
+        _listener     = nullptr;
+        _wrapper      = nullptr;
+        _bandHeight          = 64;
+        _presentation        = Presentation::Default;
+        _transport           = Transport::Automatic;
+        _bandwidth           = 0;
+        _coalesceMouseMotion = false;
+        _queueEvents         = false;
+        _resizable           = false;
+        _translucent         = false;
+        _quality             = Quality::Exact;
+        for (int i = 0; i < 256; ++i)
+            _palette[i] = TrueColorPixel(integer8(i), integer8(i), integer8(i), 255);
         defaults();
     }
 
@@ -81,6 +178,109 @@ public:
             return false;
     }
 
+    // note: this default only takes the formats of the modes and video, override it to take other formats.
+    // palette indices are looked up into a temporary truecolor frame, override it to look them up in your format.
+
+    bool update(const void* pixels, Format format, const Rectangle* dirtyBox) override
+    {
+        if (format == Format::XRGB8888)
+            return update(static_cast<const TrueColorPixel*>(pixels), dirtyBox);
+        else if (format == Format::XBGRFFFF)
+            return update(static_cast<const FloatingPointPixel*>(pixels), dirtyBox);
+
+        const void* planes[3];
+        int         pitches[3];
+        if (pixels && videoPlanes(format, pixels, _width, _height, planes, pitches))
+            return update(planes, pitches, format, ColorSpace::BT601, dirtyBox);
+
+        if (format != Format::Indexed8 || !pixels)
+            return false;
+
+        const int       count   = _width * _height;
+        TrueColorPixel* frame   = static_cast<TrueColorPixel*>(allocatePixels(static_cast<integer64>(count) * sizeof(TrueColorPixel)));
+        const integer8* indices = static_cast<const integer8*>(pixels);
+        if (!frame)
+            return false;
+
+        for (int i = 0; i < count; ++i)
+            frame[i] = _palette[indices[i]];
+
+        const bool result = update(frame, dirtyBox);
+
+        freePixels(frame);
+
+        return result;
+    }
+
+    // note: this default copies the viewport out into a temporary frame, override it to read the viewport in place
+
+    bool update(const void* canvas, Format format, int pitch, int x, int y, const Rectangle* dirtyBox) override
+    {
+        const int size = pixelSize(format);
+        if (!canvas || !viewportFits(size, pitch, x, y))
+            return false;
+
+        const char* viewport = static_cast<const char*>(canvas) + y * pitch + x * size;
+        const int   rowSize  = _width * size;
+
+        if (pitch == rowSize)
+            return update(viewport, format, dirtyBox);
+
+        char* frame = static_cast<char*>(allocatePixels(static_cast<integer64>(rowSize) * _height));
+        if (!frame)
+            return false;
+
+        for (int row = 0; row < _height; ++row)
+        {
+#ifndef PIXELTOASTER_NO_CRT
+            memcpy(frame + row * rowSize, viewport + row * pitch, rowSize);
+#else
+            for (int i = 0; i < rowSize; ++i)
+                frame[row * rowSize + i] = viewport[row * pitch + i];
+#endif
+        }
+
+        const bool result = update(frame, format, dirtyBox);
+
+        freePixels(frame);
+
+        return result;
+    }
+
+    // note: this default converts video into a temporary truecolor frame, override it to convert straight to your format
+
+    bool update(const void* const planes[], const int pitches[], Format format, ColorSpace colorSpace, const Rectangle* dirtyBox) override
+    {
+        Converter_YUV converter;
+        if (!planes || !pitches || !converter.select(format, colorSpace, Format::XRGB8888))
+            return false;
+
+        TrueColorPixel* frame = static_cast<TrueColorPixel*>(allocatePixels(static_cast<integer64>(_width) * _height * sizeof(TrueColorPixel)));
+        if (!frame)
+            return false;
+
+        for (int row = 0; row < _height; ++row)
+            converter.convert(planes, pitches, 0, row, frame + row * _width, _width);
+
+        const bool result = update(frame, dirtyBox);
+
+        freePixels(frame);
+
+        return result;
+    }
+
+    // note: this default updates the whole frame, override it to move the contents that stay in view
+
+    bool scroll(int dx, int dy, const void* pixels, Format format) override
+    {
+        return update(pixels, format, nullptr);
+    }
+
+    Format format() const override
+    {
+        return Format::Unknown;
+    }
+
     const char* title() const override
     {
         return _title;
@@ -131,13 +331,231 @@ public:
         return _wrapper;
     }
 
+    void bandHeight(int rows) override
+    {
+        _bandHeight = rows > 0 ? rows : 0;
+    }
+
+    int bandHeight() const override
+    {
+        return _bandHeight;
+    }
+
+    void coalesceMouseMotion(bool coalesce) override
+    {
+        _coalesceMouseMotion = coalesce;
+    }
+
+    bool coalesceMouseMotion() const override
+    {
+        return _coalesceMouseMotion;
+    }
+
+    void resizable(bool resizable) override
+    {
+        _resizable = resizable;
+    }
+
+    bool resizable() const override
+    {
+        return _resizable;
+    }
+
+    void translucent(bool translucent) override
+    {
+        _translucent = translucent;
+    }
+
+    bool translucent() const override
+    {
+        return _translucent;
+    }
+
+    void palette(const TrueColorPixel colors[], int first, int count) override
+    {
+        if (!colors || first < 0)
+            return;
+
+        for (int i = 0; i < count && first + i < 256; ++i)
+            _palette[first + i] = colors[i];
+    }
+
+    const TrueColorPixel* palette() const override
+    {
+        return _palette;
+    }
+
+    void quality(Quality quality) override
+    {
+        _quality = quality;
+    }
+
+    Quality quality() const override
+    {
+        return _quality;
+    }
+
+    void queueEvents(bool queue) override
+    {
+        _queueEvents = queue;
+    }
+
+    bool queueEvents() const override
+    {
+        return _queueEvents;
+    }
+
+    bool pollEvent(Event& event) override
+    {
+        return _events.pop(event);
+    }
+
+    void presentation(Presentation presentation) override
+    {
+        _presentation = presentation;
+    }
+
+    Presentation presentation() const override
+    {
+        return _presentation;
+    }
+
+    void transport(Transport transport) override
+    {
+        _transport = transport;
+    }
+
+    Transport transport() const override
+    {
+        return _transport;
+    }
+
+    void bandwidth(int bytesPerSecond) override
+    {
+        _bandwidth = bytesPerSecond > 0 ? bytesPerSecond : 0;
+    }
+
+    int bandwidth() const override
+    {
+        return _bandwidth;
+    }
+
+    bool timing(Timing& timing) const override
+    {
+        return false;
+    }
+
+    bool waitEvents(double timeout) override
+    {
+        return false;
+    }
+
+    // update a group of displays created by the same platform.
+    // exactly one of the pixel pointers of each display is non-null.
+    // this default just updates them one by one, platforms that can do better hide it with their own.
+
+    static bool updateGroup(DisplayInterface* const displays[], const TrueColorPixel* const trueColorPixels[], const FloatingPointPixel* const floatingPointPixels[], int count)
+    {
+        bool result = true;
+
+        for (int i = 0; i < count; ++i)
+        {
+            if (trueColorPixels[i])
+                result &= displays[i]->update(trueColorPixels[i]);
+            else
+                result &= displays[i]->update(floatingPointPixels[i]);
+        }
+
+        return result;
+    }
+
+    // forget pixel conversions shared between displays created by the same platform.
+    // this default does nothing, platforms that share conversions hide it with their own.
+
+    static void invalidate(const void* pixels)
+    {
+    }
+
+    // allocate memory for pixels aligned to a cache line, null if there is not enough memory.
+    // this default over-allocates and keeps the start of the allocation just before the pixels,
+    // platforms that can do better, for example with huge pages, hide it with their own.
+    // note: without the crt this falls back to new, like the rest of the library
+
+    static void* allocatePixels(integer64 bytes)
+    {
+#ifndef PIXELTOASTER_NO_CRT
+        char* memory = static_cast<char*>(malloc(bytes + pixelAlignment));
+#else
+        char* memory = new char[bytes + pixelAlignment];
+#endif
+        if (!memory)
+            return nullptr;
+
+        char* pixels = memory + pixelAlignment - (reinterpret_cast<integer64>(memory) & (pixelAlignment - 1));
+
+        reinterpret_cast<char**>(pixels)[-1] = memory;
+
+        return pixels;
+    }
+
+    static void freePixels(void* pixels)
+    {
+#ifndef PIXELTOASTER_NO_CRT
+        free(reinterpret_cast<char**>(pixels)[-1]);
+#else
+        delete[] reinterpret_cast<char**>(pixels)[-1];
+#endif
+    }
+
 protected:
+    enum
+    {
+        pixelAlignment = 64 // bytes, one cache line
+    };
+
     // note: override this "unified" update to implement your display update.
     // only one of the pointers will be non-null, this allows you to avoid
     // duplicating update code between truecolor and floating point update methods.
 
     virtual bool update(const TrueColorPixel* trueColorPixels, const FloatingPointPixel* floatingPointPixels, const Rectangle* dirtyBox) { return true; }
 
+    // true if a viewport the size of the display at x, y fits within canvas rows pitch bytes apart, of pixels size bytes each
+
+    bool viewportFits(int size, int pitch, int x, int y) const
+    {
+        return size > 0 && x >= 0 && y >= 0 && pitch >= (x + _width) * size;
+    }
+
+    // change the size of an open display without closing it.
+    // note: the platform display is responsible for resizing its window and buffers to match.
+
+    void resize(int width, int height)
+    {
+        _width  = width;
+        _height = height;
+    }
+
+    // put an input event in the queue if queueing was requested.
+    // note: call this from the thread that pumps events, it is the only one allowed to push.
+
+    void queueEvent(Event::Type type, double time, Key key, const Mouse* mouse, bool active)
+    {
+        if (!_queueEvents)
+            return;
+
+        Event event;
+        event.type   = type;
+        event.time   = time;
+        event.key    = key;
+        event.active = active;
+        if (mouse)
+            event.mouse = *mouse;
+        else
+            event.mouse = Mouse();
+
+        _events.push(event);
+    }
+
     // this defaults is virtual, override it to add your own defaults
     // but make sure you always call the superclass defaults in your overridden function!
     // note: due to c++ constructor oddities, make sure you also call defaults in your own
@@ -180,7 +598,116 @@ private:
     Output            _output;
     bool              _open;
     Listener*         _listener;
-    DisplayInterface* _wrapper; // required for listener callbacks
+    DisplayInterface* _wrapper;             // required for listener callbacks
+    int               _bandHeight;          // rows per converted band, 0 means whole frame
+    Presentation      _presentation;        // requested presentation mode
+    Transport         _transport;           // requested transport
+    int               _bandwidth;           // bytes per second for remote transport, 0 means no budget
+    bool              _coalesceMouseMotion; // send consecutive mouse moves as one callback
+    bool              _queueEvents;         // put input events in _events as well
+    bool              _resizable;           // let the user resize the window
+    bool              _translucent;         // show the desktop through pixels that are not opaque
+    TrueColorPixel    _palette[256];        // colors of the palette indices
+    Quality           _quality;             // how exactly floating point pixels are converted
+    EventQueue        _events;
+};
+
+// tells which frames a conversion can be shared between, see UnixDisplay::findConversion.
+// note: the quality only changes how floating point pixels are converted, other frames are shared whatever it is
+
+struct ConversionKey
+{
+    ConversionKey()
+    {
+        source       = nullptr;
+        count        = 0;
+        pitch        = 0;
+        sourceFormat = Format::Unknown;
+        destFormat   = Format::Unknown;
+        quality      = Quality::Exact;
+    }
+
+    ConversionKey(const void* source, int count, int pitch, Format sourceFormat, Format destFormat, Quality quality)
+    {
+        this->source       = source;
+        this->count        = count;
+        this->pitch        = pitch;
+        this->sourceFormat = sourceFormat;
+        this->destFormat   = destFormat;
+        this->quality      = sourceFormat == Format::XBGRFFFF ? quality : Quality(Quality::Exact);
+    }
+
+    bool operator==(const ConversionKey& other) const
+    {
+        return source == other.source && count == other.count && pitch == other.pitch && sourceFormat == other.sourceFormat &&
+               destFormat == other.destFormat && quality == other.quality;
+    }
+
+    const void* source;
+    int         count;
+    int         pitch;
+    Format      sourceFormat;
+    Format      destFormat;
+    Quality     quality;
+};
+
+// collects consecutive mouse moves so a display can send them as one callback.
+// see DisplayInterface::coalesceMouseMotion.
+
+class MouseMotionBuffer
+{
+public:
+    MouseMotionBuffer()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        _count = 0;
+        _moved = false;
+    }
+
+    void add(Listener* listener, DisplayInterface& display, const Mouse& mouse)
+    {
+        if (_count == capacity)
+            flush(listener, display);
+
+        _samples[_count++] = mouse;
+    }
+
+    // send the moves collected so far, if any
+
+    void flush(Listener* listener, DisplayInterface& display)
+    {
+        if (_count == 0)
+            return;
+
+        const Mouse latest = _samples[_count - 1];
+        const Mouse origin = _moved ? _last : _samples[0];
+        const int   count  = _count;
+
+        _last  = latest;
+        _moved = true;
+        _count = 0;
+
+        if (listener)
+        {
+            listener->onMouseMotion(display, _samples, count, latest.x - origin.x, latest.y - origin.y);
+            listener->onMouseMove(display, latest);
+        }
+    }
+
+private:
+    enum
+    {
+        capacity = 256
+    };
+
+    Mouse _samples[capacity];
+    int   _count;
+    Mouse _last;  ///< latest position sent
+    bool  _moved; ///< true once a position was sent
 };
 
 #ifndef PIXELTOASTER_NO_CRT
@@ -57,11 +57,13 @@ inline __m128i clamped_fraction_8(__m128 input)
 {
     auto maskRet = _mm_set1_epi32(0x07F8000);
     auto onei    = _mm_set1_epi32(0x3F7FFFFF);
-    auto onef    = _mm_castsi128_ps(onei);
+    auto onef    = _mm_set1_ps(1.0f);
+
+    // note: same as the scalar version, everything from just below one up saturates
 
     auto xi   = clamp_positive(_mm_castps_si128(input));
     auto xf   = _mm_castsi128_ps(xi);
-    auto mask = _mm_cmpgt_epi32(xi, onei);
+    auto mask = _mm_cmpgt_epi32(xi, _mm_set1_epi32(0x3F7FFFFE));
 
     // Compute either cases simultaneously and merge them later
     auto y0 = _mm_and_si128(mask, onei);
@@ -159,7 +161,7 @@ inline void convert_XBGRFFFF_to_XRGB8888(const Pixel source[], integer32 destina
         destination[4 * i + 3] = r3 | g3 | b3;
     }
 
-    offset += 4 * count;
+    offset = 4 * numBlocks;
 #endif
 
     for (unsigned int i = offset; i < count; ++i)
@@ -204,22 +206,79 @@ inline void convert_XBGR8888_to_XBGRFFFF(const integer32 source[], Pixel destina
     }
 }
 
-inline void convert_XBGRFFFF_to_RGB888(const Pixel source[], integer8 destination[], unsigned int count)
+// packed 24 bit pixels are written lowest byte first, so the component shifted by 0 lands first in memory
+
+#ifdef PIXELTOASTER_USE_SSE2
+inline void store_888(__m128i pixels, integer8 destination[])
 {
-    for (unsigned int i = 0; i < count; ++i)
+    // squeeze out the unused top byte of each pixel, first within each 64 bit half then across the halves
+
+    const __m128i low  = _mm_set_epi32(0, 0x00FFFFFF, 0, 0x00FFFFFF);
+    const __m128i high = _mm_set_epi32(0x00FFFFFF, 0, 0x00FFFFFF, 0);
+
+    const __m128i pairs  = _mm_or_si128(_mm_and_si128(pixels, low), _mm_srli_epi64(_mm_and_si128(pixels, high), 8));
+    const __m128i packed = _mm_or_si128(_mm_move_epi64(pairs), _mm_slli_si128(_mm_srli_si128(pairs, 8), 6));
+
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(destination), packed);
+
+    const integer32 last = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+
+    destination[8]  = (integer8)last;
+    destination[9]  = (integer8)(last >> 8);
+    destination[10] = (integer8)(last >> 16);
+    destination[11] = (integer8)(last >> 24);
+}
+#endif
+
+template <int redShift, int blueShift>
+inline void convert_XBGRFFFF_to_888(const Pixel source[], integer8 destination[], unsigned int count)
+{
+    unsigned int offset = 0;
+
+#ifdef PIXELTOASTER_USE_SSE2
+    const unsigned int numBlocks = count / 4;
+
+    for (unsigned int i = 0; i < numBlocks; ++i)
+    {
+        __m128 r = _mm_loadu_ps(reinterpret_cast<const float*>(&source[4 * i + 0]));
+        __m128 g = _mm_loadu_ps(reinterpret_cast<const float*>(&source[4 * i + 1]));
+        __m128 b = _mm_loadu_ps(reinterpret_cast<const float*>(&source[4 * i + 2]));
+        __m128 a = _mm_loadu_ps(reinterpret_cast<const float*>(&source[4 * i + 3]));
+
+        _MM_TRANSPOSE4_PS(r, g, b, a);
+
+        const __m128i red   = _mm_slli_epi32(_mm_srli_epi32(clamped_fraction_8(r), 15), redShift);
+        const __m128i green = _mm_srli_epi32(clamped_fraction_8(g), 7);
+        const __m128i blue  = _mm_slli_epi32(_mm_srli_epi32(clamped_fraction_8(b), 15), blueShift);
+
+        store_888(_mm_or_si128(_mm_or_si128(red, green), blue), destination + 12 * i);
+    }
+
+    offset = 4 * numBlocks;
+    destination += 3 * offset;
+#endif
+
+    for (unsigned int i = offset; i < count; ++i)
     {
         const integer32 r = clamped_fraction_8(source[i].r) >> 15;
-        const integer32 g = clamped_fraction_8(source[i].g) >> 15;
+        const integer32 g = clamped_fraction_8(source[i].g) >> 7;
         const integer32 b = clamped_fraction_8(source[i].b) >> 15;
 
-        destination[0] = (integer8)r;
-        destination[1] = (integer8)g;
-        destination[2] = (integer8)b;
+        const integer32 pixel = (r << redShift) | g | (b << blueShift);
+
+        destination[0] = (integer8)pixel;
+        destination[1] = (integer8)(pixel >> 8);
+        destination[2] = (integer8)(pixel >> 16);
 
         destination += 3;
     }
 }
 
+inline void convert_XBGRFFFF_to_RGB888(const Pixel source[], integer8 destination[], unsigned int count)
+{
+    convert_XBGRFFFF_to_888<0, 16>(source, destination, count);
+}
+
 inline void convert_RGB888_to_XBGRFFFF(const integer8 source[], Pixel destination[], unsigned int count)
 {
     for (unsigned int i = 0; i < count; ++i)
@@ -234,18 +293,7 @@ inline void convert_RGB888_to_XBGRFFFF(const integer8 source[], Pixel destinatio
 
 inline void convert_XBGRFFFF_to_BGR888(const Pixel source[], integer8 destination[], unsigned int count)
 {
-    for (unsigned int i = 0; i < count; ++i)
-    {
-        const integer32 r = clamped_fraction_8(source[i].r) >> 15;
-        const integer32 g = clamped_fraction_8(source[i].g) >> 15;
-        const integer32 b = clamped_fraction_8(source[i].b) >> 15;
-
-        destination[0] = (integer8)b;
-        destination[1] = (integer8)g;
-        destination[2] = (integer8)r;
-
-        destination += 3;
-    }
+    convert_XBGRFFFF_to_888<16, 0>(source, destination, count);
 }
 
 inline void convert_BGR888_to_XBGRFFFF(const integer8 source[], Pixel destination[], unsigned int count)
@@ -372,6 +420,85 @@ inline void convert_XBGR1555_to_XBGRFFFF(const integer16 source[], Pixel destina
     }
 }
 
+// fast floating point conversion, see Quality::Fast.
+// components are scaled to 256 steps and truncated, the saturating packs of sse2 clamp them for free.
+// this is at most one step darker than clamped_fraction_8, which rounds when it adds one.
+
+inline integer32 fast_fraction_8(float input)
+{
+    const float scaled = input * 256.0f;
+
+    if (!(scaled < 255.0f))
+        return 255; // note: nan saturates too, like the sse2 version
+
+    return scaled > 0.0f ? (integer32)scaled : 0;
+}
+
+#ifdef PIXELTOASTER_USE_SSE2
+template <bool swapRedBlue>
+inline __m128i fast_fraction_8(const Pixel& pixel)
+{
+    __m128 components = _mm_loadu_ps(reinterpret_cast<const float*>(&pixel));
+
+    if (swapRedBlue)
+        components = _mm_shuffle_ps(components, components, _MM_SHUFFLE(3, 0, 1, 2));
+
+    // note: min returns the limit for nan
+
+    const __m128 limit = _mm_set1_ps(256.0f);
+
+    return _mm_cvttps_epi32(_mm_min_ps(_mm_mul_ps(components, _mm_set1_ps(256.0f)), limit));
+}
+#endif
+
+template <bool swapRedBlue>
+inline void convert_XBGRFFFF_to_8888_fast(const Pixel source[], integer32 destination[], unsigned int count)
+{
+    unsigned int offset = 0;
+
+#ifdef PIXELTOASTER_USE_SSE2
+    const unsigned int numBlocks = count / 16;
+    const __m128i      mask      = _mm_set1_epi32(0x00FFFFFF);
+
+    for (unsigned int i = 0; i < numBlocks; ++i)
+    {
+        const Pixel* block  = &source[16 * i];
+        __m128i*     output = reinterpret_cast<__m128i*>(&destination[16 * i]);
+
+        // four pixels of 32 bit components to 16 bits, then to 8 bits, per store
+
+        for (int j = 0; j < 4; ++j)
+        {
+            const __m128i low  = _mm_packs_epi32(fast_fraction_8<swapRedBlue>(block[4 * j + 0]), fast_fraction_8<swapRedBlue>(block[4 * j + 1]));
+            const __m128i high = _mm_packs_epi32(fast_fraction_8<swapRedBlue>(block[4 * j + 2]), fast_fraction_8<swapRedBlue>(block[4 * j + 3]));
+
+            _mm_storeu_si128(output + j, _mm_and_si128(_mm_packus_epi16(low, high), mask));
+        }
+    }
+
+    offset = 16 * numBlocks;
+#endif
+
+    for (unsigned int i = offset; i < count; ++i)
+    {
+        const integer32 r = fast_fraction_8(source[i].r);
+        const integer32 g = fast_fraction_8(source[i].g);
+        const integer32 b = fast_fraction_8(source[i].b);
+
+        destination[i] = swapRedBlue ? (r << 16) | (g << 8) | b : (b << 16) | (g << 8) | r;
+    }
+}
+
+inline void convert_XBGRFFFF_to_XRGB8888_fast(const Pixel source[], integer32 destination[], unsigned int count)
+{
+    convert_XBGRFFFF_to_8888_fast<true>(source, destination, count);
+}
+
+inline void convert_XBGRFFFF_to_XBGR8888_fast(const Pixel source[], integer32 destination[], unsigned int count)
+{
+    convert_XBGRFFFF_to_8888_fast<false>(source, destination, count);
+}
+
 // integer to integer converters
 
 inline void convert_XRGB8888_to_XBGR8888(const integer32 source[], integer32 destination[], unsigned int count)
@@ -390,17 +517,51 @@ inline void convert_XBGR8888_to_XRGB8888(const integer32 source[], integer32 des
     convert_XRGB8888_to_XBGR8888(source, destination, count);
 }
 
-inline void convert_XRGB8888_to_RGB888(const integer32 source[], integer8 destination[], unsigned int count)
+template <int redShift, int blueShift>
+inline void convert_XRGB8888_to_888(const integer32 source[], integer8 destination[], unsigned int count)
 {
-    for (unsigned int i = 0; i < count; ++i)
+    unsigned int offset = 0;
+
+#ifdef PIXELTOASTER_USE_SSE2
+    const unsigned int numBlocks = count / 4;
+    const __m128i      mask      = _mm_set1_epi32(0x000000FF);
+
+    for (unsigned int i = 0; i < numBlocks; ++i)
+    {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&source[4 * i]));
+
+        const __m128i red   = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(pixels, 16), mask), redShift);
+        const __m128i green = _mm_and_si128(pixels, _mm_set1_epi32(0x0000FF00));
+        const __m128i blue  = _mm_slli_epi32(_mm_and_si128(pixels, mask), blueShift);
+
+        store_888(_mm_or_si128(_mm_or_si128(red, green), blue), destination + 12 * i);
+    }
+
+    offset = 4 * numBlocks;
+    destination += 3 * offset;
+#endif
+
+    for (unsigned int i = offset; i < count; ++i)
     {
-        destination[0] = (integer8)((source[i] & 0x00FF0000) >> 16);
-        destination[1] = (integer8)((source[i] & 0x0000FF00) >> 8);
-        destination[2] = (integer8)((source[i] & 0x000000FF));
+        const integer32 r = (source[i] & 0x00FF0000) >> 16;
+        const integer32 g = (source[i] & 0x0000FF00);
+        const integer32 b = (source[i] & 0x000000FF);
+
+        const integer32 pixel = (r << redShift) | g | (b << blueShift);
+
+        destination[0] = (integer8)pixel;
+        destination[1] = (integer8)(pixel >> 8);
+        destination[2] = (integer8)(pixel >> 16);
+
         destination += 3;
     }
 }
 
+inline void convert_XRGB8888_to_RGB888(const integer32 source[], integer8 destination[], unsigned int count)
+{
+    convert_XRGB8888_to_888<0, 16>(source, destination, count);
+}
+
 inline void convert_RGB888_to_XRGB8888(const integer8 source[], integer32 destination[], unsigned int count)
 {
     for (unsigned int i = 0; i < count; ++i)
@@ -417,13 +578,7 @@ inline void convert_RGB888_to_XRGB8888(const integer8 source[], integer32 destin
 
 inline void convert_XRGB8888_to_BGR888(const integer32 source[], integer8 destination[], unsigned int count)
 {
-    for (unsigned int i = 0; i < count; ++i)
-    {
-        destination[0] = (integer8)((source[i] & 0x000000FF));
-        destination[1] = (integer8)((source[i] & 0x0000FF00) >> 8);
-        destination[2] = (integer8)((source[i] & 0x00FF0000) >> 16);
-        destination += 3;
-    }
+    convert_XRGB8888_to_888<16, 0>(source, destination, count);
 }
 
 inline void convert_BGR888_to_XRGB8888(const integer8 source[], integer32 destination[], unsigned int count)
@@ -544,67 +699,1063 @@ inline void convert_XBGR1555_to_XRGB8888(const integer16 source[], integer32 des
     }
 }
 
-// copy converters
+// premultiplied alpha conversion routines.
+// the alpha of the source pixel becomes its opacity, and the color is scaled by it as compositors expect.
+// note: the vector and scalar paths do the same arithmetic, so a pixel converts the same way in either.
 
-inline void convert_XRGB8888_to_XRGB8888(const integer32 source[], integer32 destination[], unsigned int count)
+inline float clamped_unit(float input)
 {
-#ifndef PIXELTOASTER_NO_CRT
-    memcpy(destination, source, count * 4);
-#else
-    for (unsigned int i = 0; i < count; ++i)
-        destination[i] = source[i];
+    return input > 0.0f ? (input < 1.0f ? input : 1.0f) : 0.0f;
+}
+
+// color * alpha / 255 rounded to nearest, exact for any two 8 bit values
+
+inline integer32 premultiply_8(integer32 color, integer32 alpha)
+{
+    const integer32 product = color * alpha + 128;
+    return (product + (product >> 8)) >> 8;
+}
+
+#ifdef PIXELTOASTER_USE_SSE2
+// premultiply two pixels widened to 16 bits per component, in b, g, r, a order
+
+inline __m128i premultiply_8(__m128i pixels)
+{
+    const __m128i alphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    const __m128i opaque     = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+
+    // scale the color by alpha and alpha by one, which leaves it as it is
+
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    alpha         = _mm_or_si128(_mm_andnot_si128(alphaLanes, alpha), opaque);
+
+    const __m128i product = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+}
+#endif
+
+inline void convert_XBGRFFFF_to_ARGB8888(const Pixel source[], integer32 destination[], unsigned int count)
+{
+    unsigned int offset = 0;
+
+#ifdef PIXELTOASTER_USE_SSE2
+    const __m128 zero      = _mm_setzero_ps();
+    const __m128 one       = _mm_set1_ps(1.0f);
+    const __m128 scale     = _mm_set1_ps(255.0f);
+    const __m128 half      = _mm_set1_ps(0.5f);
+    const __m128 alphaLane = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+
+    const unsigned int numBlocks = count / 4;
+
+    for (unsigned int i = 0; i < numBlocks; ++i)
+    {
+        __m128i components[4];
+
+        for (unsigned int k = 0; k < 4; ++k)
+        {
+            // b, g, r, a order, so the packed bytes are argb integers in memory
+
+            __m128 p = _mm_loadu_ps(reinterpret_cast<const float*>(&source[4 * i + k]));
+            p        = _mm_min_ps(_mm_max_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 0, 1, 2)), zero), one);
+
+            const __m128 alpha = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 3));
+            p                  = _mm_mul_ps(p, _mm_or_ps(_mm_andnot_ps(alphaLane, alpha), _mm_and_ps(alphaLane, one)));
+
+            components[k] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(p, scale), half));
+        }
+
+        const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(components[0], components[1]), _mm_packs_epi32(components[2], components[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&destination[4 * i]), packed);
+    }
+
+    offset = 4 * numBlocks;
 #endif
+
+    for (unsigned int i = offset; i < count; ++i)
+    {
+        const float     alpha = clamped_unit(source[i].a);
+        const integer32 r     = (integer32)(clamped_unit(source[i].r) * alpha * 255.0f + 0.5f);
+        const integer32 g     = (integer32)(clamped_unit(source[i].g) * alpha * 255.0f + 0.5f);
+        const integer32 b     = (integer32)(clamped_unit(source[i].b) * alpha * 255.0f + 0.5f);
+        const integer32 a     = (integer32)(alpha * 255.0f + 0.5f);
+
+        destination[i] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
 }
 
-inline void convert_XBGRFFFF_to_XBGRFFFF(const Pixel source[], Pixel destination[], unsigned int count)
+inline void convert_XRGB8888_to_ARGB8888(const integer32 source[], integer32 destination[], unsigned int count)
+{
+    unsigned int offset = 0;
+
+#ifdef PIXELTOASTER_USE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+
+    const unsigned int numBlocks = count / 4;
+
+    for (unsigned int i = 0; i < numBlocks; ++i)
+    {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&source[4 * i]));
+
+        const __m128i low  = premultiply_8(_mm_unpacklo_epi8(pixels, zero));
+        const __m128i high = premultiply_8(_mm_unpackhi_epi8(pixels, zero));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&destination[4 * i]), _mm_packus_epi16(low, high));
+    }
+
+    offset = 4 * numBlocks;
+#endif
+
+    for (unsigned int i = offset; i < count; ++i)
+    {
+        const integer32 color = source[i];
+        const integer32 a     = color >> 24;
+        const integer32 r     = premultiply_8((color >> 16) & 0xFF, a);
+        const integer32 g     = premultiply_8((color >> 8) & 0xFF, a);
+        const integer32 b     = premultiply_8(color & 0xFF, a);
+
+        destination[i] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+}
+
+// formats without alpha are opaque, so truecolor converted from them has to be as well
+
+inline void convert_XRGB8888_to_opaque_ARGB8888(const integer32 source[], integer32 destination[], unsigned int count)
 {
-#ifndef PIXELTOASTER_NO_CRT
-    memcpy(destination, source, count * 16);
-#else
     for (unsigned int i = 0; i < count; ++i)
-        destination[i] = source[i];
+        destination[i] = source[i] | 0xFF000000;
+}
+
+// deep color conversion routines, 10 bits per component
+
+inline integer32 clamped_fraction_10(float input)
+{
+    return (integer32)(clamped_unit(input) * 1023.0f + 0.5f);
+}
+
+#ifdef PIXELTOASTER_USE_SSE2
+inline __m128i clamped_fraction_10(__m128 input)
+{
+    const __m128 clamped = _mm_min_ps(_mm_max_ps(input, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, _mm_set1_ps(1023.0f)), _mm_set1_ps(0.5f)));
+}
+#endif
+
+// packs red and blue at the given shifts with green in the middle, four pixels at a time with sse2
+
+template <int redShift, int blueShift>
+inline void convert_XBGRFFFF_to_2101010(const Pixel source[], integer32 destination[], unsigned int count)
+{
+    unsigned int offset = 0;
+
+#ifdef PIXELTOASTER_USE_SSE2
+    const unsigned int numBlocks = count / 4;
+
+    for (unsigned int i = 0; i < numBlocks; ++i)
+    {
+        __m128 r = _mm_loadu_ps(reinterpret_cast<const float*>(&source[4 * i + 0]));
+        __m128 g = _mm_loadu_ps(reinterpret_cast<const float*>(&source[4 * i + 1]));
+        __m128 b = _mm_loadu_ps(reinterpret_cast<const float*>(&source[4 * i + 2]));
+        __m128 a = _mm_loadu_ps(reinterpret_cast<const float*>(&source[4 * i + 3]));
+
+        // one pixel per register to one component per register
+
+        _MM_TRANSPOSE4_PS(r, g, b, a);
+
+        const __m128i red   = _mm_slli_epi32(clamped_fraction_10(r), redShift);
+        const __m128i green = _mm_slli_epi32(clamped_fraction_10(g), 10);
+        const __m128i blue  = _mm_slli_epi32(clamped_fraction_10(b), blueShift);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&destination[4 * i]), _mm_or_si128(_mm_or_si128(red, green), blue));
+    }
+
+    offset = 4 * numBlocks;
 #endif
+
+    for (unsigned int i = offset; i < count; ++i)
+    {
+        const integer32 r = clamped_fraction_10(source[i].r) << redShift;
+        const integer32 g = clamped_fraction_10(source[i].g) << 10;
+        const integer32 b = clamped_fraction_10(source[i].b) << blueShift;
+
+        destination[i] = r | g | b;
+    }
 }
 
-// declare set of converter classes
+inline void convert_XBGRFFFF_to_XRGB2101010(const Pixel source[], integer32 destination[], unsigned int count)
+{
+    convert_XBGRFFFF_to_2101010<20, 0>(source, destination, count);
+}
 
-class ConverterAdapter : public Converter
+inline void convert_XBGRFFFF_to_XBGR2101010(const Pixel source[], integer32 destination[], unsigned int count)
 {
-    virtual void begin() override {}
-    virtual void end() override {}
-};
+    convert_XBGRFFFF_to_2101010<0, 20>(source, destination, count);
+}
 
-#define PIXELTOASTER_CONVERTER(type, source_type, destination_type)                             \
-                                                                                                \
-    class Converter_##type : public ConverterAdapter                                            \
-    {                                                                                           \
-        void convert(const void* source, void* destination, int pixels)                         \
-        {                                                                                       \
-            convert_##type((const source_type*)source, (destination_type*)destination, pixels); \
-        }                                                                                       \
-    };
+// widens each 8 bit component placed at the top of its 10 bit field by repeating its top two bits below it,
+// so black stays black and full intensity stays full
 
-PIXELTOASTER_CONVERTER(XBGRFFFF_to_XBGRFFFF, Pixel, Pixel);
-PIXELTOASTER_CONVERTER(XBGRFFFF_to_XRGB8888, Pixel, integer32);
-PIXELTOASTER_CONVERTER(XBGRFFFF_to_XBGR8888, Pixel, integer32);
-PIXELTOASTER_CONVERTER(XBGRFFFF_to_RGB888, Pixel, integer8);
-PIXELTOASTER_CONVERTER(XBGRFFFF_to_BGR888, Pixel, integer8);
-PIXELTOASTER_CONVERTER(XBGRFFFF_to_RGB565, Pixel, integer16);
-PIXELTOASTER_CONVERTER(XBGRFFFF_to_BGR565, Pixel, integer16);
-PIXELTOASTER_CONVERTER(XBGRFFFF_to_XRGB1555, Pixel, integer16);
-PIXELTOASTER_CONVERTER(XBGRFFFF_to_XBGR1555, Pixel, integer16);
+inline integer32 widen_2101010(integer32 spread)
+{
+    return spread | ((spread >> 8) & 0x00300C03);
+}
 
-PIXELTOASTER_CONVERTER(XRGB8888_to_XBGRFFFF, integer32, Pixel);
-PIXELTOASTER_CONVERTER(XRGB8888_to_XRGB8888, integer32, integer32);
-PIXELTOASTER_CONVERTER(XRGB8888_to_XBGR8888, integer32, integer32);
-PIXELTOASTER_CONVERTER(XRGB8888_to_RGB888, integer32, integer8);
-PIXELTOASTER_CONVERTER(XRGB8888_to_BGR888, integer32, integer8);
-PIXELTOASTER_CONVERTER(XRGB8888_to_RGB565, integer32, integer16);
-PIXELTOASTER_CONVERTER(XRGB8888_to_BGR565, integer32, integer16);
-PIXELTOASTER_CONVERTER(XRGB8888_to_XRGB1555, integer32, integer16);
-PIXELTOASTER_CONVERTER(XRGB8888_to_XBGR1555, integer32, integer16);
+inline void convert_XRGB8888_to_XRGB2101010(const integer32 source[], integer32 destination[], unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const integer32 color = source[i];
+        destination[i]        = widen_2101010(((color & 0x00FF0000) << 6) | ((color & 0x0000FF00) << 4) | ((color & 0x000000FF) << 2));
+    }
+}
 
-#undef PIXELTOASTER_CONVERTER
+inline void convert_XRGB8888_to_XBGR2101010(const integer32 source[], integer32 destination[], unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const integer32 color = source[i];
+        destination[i]        = widen_2101010(((color & 0x00FF0000) >> 14) | ((color & 0x0000FF00) << 4) | ((color & 0x000000FF) << 22));
+    }
+}
+
+inline void convert_XRGB2101010_to_XRGB8888(const integer32 source[], integer32 destination[], unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const integer32 color = source[i];
+        destination[i]        = ((color >> 6) & 0x00FF0000) | ((color >> 4) & 0x0000FF00) | ((color >> 2) & 0x000000FF);
+    }
+}
+
+inline void convert_XBGR2101010_to_XRGB8888(const integer32 source[], integer32 destination[], unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const integer32 color = source[i];
+        destination[i]        = ((color << 14) & 0x00FF0000) | ((color >> 4) & 0x0000FF00) | ((color >> 22) & 0x000000FF);
+    }
+}
+
+// palette conversion routines.
+// indices are looked up in a palette that is already in the destination format.
+// note: sse2 has no gather, so four independent lookups per iteration are what keeps the loads in flight.
+
+template <typename T>
+inline void convert_Indexed8(const integer8 source[], T destination[], const T palette[], unsigned int count)
+{
+    const unsigned int numBlocks = count / 4;
+
+    for (unsigned int i = 0; i < numBlocks; ++i)
+    {
+        const T a = palette[source[4 * i + 0]];
+        const T b = palette[source[4 * i + 1]];
+        const T c = palette[source[4 * i + 2]];
+        const T d = palette[source[4 * i + 3]];
+
+        destination[4 * i + 0] = a;
+        destination[4 * i + 1] = b;
+        destination[4 * i + 2] = c;
+        destination[4 * i + 3] = d;
+    }
+
+    for (unsigned int i = 4 * numBlocks; i < count; ++i)
+        destination[i] = palette[source[i]];
+}
+
+inline void convert_Indexed8(const integer8 source[], integer8 destination[], const integer8 palette[], unsigned int count, int size)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const integer8* color = palette + source[i] * size;
+        for (int j = 0; j < size; ++j)
+            *destination++ = color[j];
+    }
+}
+
+// video conversion routines.
+//
+// luma and chroma in the video range go to color with the coefficients of the color space in 13 bit fixed point.
+// the math is done in 16 bit lanes the way sse2 multiplies, taking the high half of the product of each value
+// shifted up by 7 bits, so the scalar and sse2 routines give the same colors to the bit.
+// each chroma sample covers a pair of pixels, and a pair of rows in 4:2:0 video, it is spread over them as we go.
+
+struct YUVCoefficients
+{
+    int y;  // luma scale
+    int rv; // red from v
+    int gu; // green from u
+    int gv; // green from v
+    int bu; // blue from u
+};
+
+inline YUVCoefficients yuvCoefficients(ColorSpace colorSpace)
+{
+    const YUVCoefficients bt601 = {9539, 13075, 3209, 6660, 16525};
+    const YUVCoefficients bt709 = {9539, 14686, 1747, 4366, 17305};
+
+    return colorSpace == ColorSpace::BT709 ? bt709 : bt601;
+}
+
+inline int yuv_multiply(int value, int coefficient)
+{
+    return (value * 128 * coefficient) >> 16;
+}
+
+inline int yuv_component(int value)
+{
+    value = (value + 8) >> 4;
+    return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+inline void yuv_to_rgb(int y, int u, int v, const YUVCoefficients& k, int& r, int& g, int& b)
+{
+    const int luma = yuv_multiply(y - 16, k.y);
+
+    u -= 128;
+    v -= 128;
+
+    r = yuv_component(luma + yuv_multiply(v, k.rv));
+    g = yuv_component(luma - yuv_multiply(u, k.gu) - yuv_multiply(v, k.gv));
+    b = yuv_component(luma + yuv_multiply(u, k.bu));
+}
+
+#ifdef PIXELTOASTER_USE_SSE2
+inline void yuv_to_rgb(__m128i y, __m128i u, __m128i v, const YUVCoefficients& k, __m128i& r, __m128i& g, __m128i& b)
+{
+    const __m128i luma     = _mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(y, _mm_set1_epi16(16)), 7), _mm_set1_epi16((short)k.y));
+    const __m128i rounding = _mm_set1_epi16(8);
+    const __m128i zero     = _mm_setzero_si128();
+    const __m128i maximum  = _mm_set1_epi16(255);
+
+    u = _mm_slli_epi16(_mm_sub_epi16(u, _mm_set1_epi16(128)), 7);
+    v = _mm_slli_epi16(_mm_sub_epi16(v, _mm_set1_epi16(128)), 7);
+
+    r = _mm_add_epi16(luma, _mm_mulhi_epi16(v, _mm_set1_epi16((short)k.rv)));
+    g = _mm_sub_epi16(_mm_sub_epi16(luma, _mm_mulhi_epi16(u, _mm_set1_epi16((short)k.gu))), _mm_mulhi_epi16(v, _mm_set1_epi16((short)k.gv)));
+    b = _mm_add_epi16(luma, _mm_mulhi_epi16(u, _mm_set1_epi16((short)k.bu)));
+
+    r = _mm_min_epi16(_mm_max_epi16(_mm_srai_epi16(_mm_add_epi16(r, rounding), 4), zero), maximum);
+    g = _mm_min_epi16(_mm_max_epi16(_mm_srai_epi16(_mm_add_epi16(g, rounding), 4), zero), maximum);
+    b = _mm_min_epi16(_mm_max_epi16(_mm_srai_epi16(_mm_add_epi16(b, rounding), 4), zero), maximum);
+}
+
+// spreads interleaved u and v in 16 bit lanes over the pixel pairs they cover
+
+inline void yuv_spread_chroma(__m128i chroma, __m128i& u, __m128i& v)
+{
+    u = _mm_and_si128(chroma, _mm_set1_epi32(0x0000FFFF));
+    v = _mm_srli_epi32(chroma, 16);
+    u = _mm_or_si128(u, _mm_slli_epi32(u, 16));
+    v = _mm_or_si128(v, _mm_slli_epi32(v, 16));
+}
+#endif
+
+// where the luma and chroma of pixel i of a row are relative to its first pixel, and how to load eight pixels with sse2.
+// rows always start on the first pixel of a pair.
+
+struct YUVLayout_I420
+{
+    enum
+    {
+        lumaStep   = 1,
+        chromaStep = 1
+    };
+
+#ifdef PIXELTOASTER_USE_SSE2
+    static void load(const integer8 y[], const integer8 u[], const integer8 v[], unsigned int i, __m128i& luma, __m128i& cb, __m128i& cr)
+    {
+        const __m128i zero = _mm_setzero_si128();
+
+        luma = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + i)), zero);
+        cb   = _mm_cvtsi32_si128(*reinterpret_cast<const int*>(u + i / 2));
+        cr   = _mm_cvtsi32_si128(*reinterpret_cast<const int*>(v + i / 2));
+        cb   = _mm_unpacklo_epi8(_mm_unpacklo_epi8(cb, cb), zero);
+        cr   = _mm_unpacklo_epi8(_mm_unpacklo_epi8(cr, cr), zero);
+    }
+#endif
+};
+
+struct YUVLayout_NV12
+{
+    enum
+    {
+        lumaStep   = 1,
+        chromaStep = 2
+    };
+
+#ifdef PIXELTOASTER_USE_SSE2
+    static void load(const integer8 y[], const integer8 u[], const integer8 v[], unsigned int i, __m128i& luma, __m128i& cb, __m128i& cr)
+    {
+        const __m128i zero = _mm_setzero_si128();
+
+        luma = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + i)), zero);
+        yuv_spread_chroma(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + i)), zero), cb, cr);
+    }
+#endif
+};
+
+struct YUVLayout_YUY2
+{
+    enum
+    {
+        lumaStep   = 2,
+        chromaStep = 4
+    };
+
+#ifdef PIXELTOASTER_USE_SSE2
+    static void load(const integer8 y[], const integer8 u[], const integer8 v[], unsigned int i, __m128i& luma, __m128i& cb, __m128i& cr)
+    {
+        const __m128i pairs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + 2 * i));
+
+        luma = _mm_and_si128(pairs, _mm_set1_epi16(0x00FF));
+        yuv_spread_chroma(_mm_srli_epi16(pairs, 8), cb, cr);
+    }
+#endif
+};
+
+// how to pack color into the destination format, one pixel at a time or eight at a time with sse2.
+// the components are truncated just like converting truecolor to the same format.
+
+template <int redShift, int blueShift, integer32 alpha>
+struct YUVPack_8888
+{
+    typedef integer32 Type;
+
+    static integer32 pack(int r, int g, int b)
+    {
+        return alpha | (r << redShift) | (g << 8) | (b << blueShift);
+    }
+
+#ifdef PIXELTOASTER_USE_SSE2
+    static void store(integer32 destination[], __m128i r, __m128i g, __m128i b)
+    {
+        const __m128i zero   = _mm_setzero_si128();
+        const __m128i low    = _mm_packus_epi16(redShift ? b : r, zero);
+        const __m128i high   = _mm_packus_epi16(redShift ? r : b, zero);
+        const __m128i top    = alpha ? _mm_set1_epi8((char)0xFF) : zero;
+        const __m128i bottom = _mm_unpacklo_epi8(low, _mm_packus_epi16(g, zero));
+        const __m128i upper  = _mm_unpacklo_epi8(high, top);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), _mm_unpacklo_epi16(bottom, upper));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + 4), _mm_unpackhi_epi16(bottom, upper));
+    }
+#endif
+};
+
+template <int redShift, int greenShift, int blueShift, int greenBits>
+struct YUVPack_16
+{
+    typedef integer16 Type;
+
+    static integer16 pack(int r, int g, int b)
+    {
+        return (integer16)(((r >> 3) << redShift) | ((g >> (8 - greenBits)) << greenShift) | ((b >> 3) << blueShift));
+    }
+
+#ifdef PIXELTOASTER_USE_SSE2
+    static void store(integer16 destination[], __m128i r, __m128i g, __m128i b)
+    {
+        r = _mm_slli_epi16(_mm_srli_epi16(r, 3), redShift);
+        g = _mm_slli_epi16(_mm_srli_epi16(g, 8 - greenBits), greenShift);
+        b = _mm_slli_epi16(_mm_srli_epi16(b, 3), blueShift);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), _mm_or_si128(_mm_or_si128(r, g), b));
+    }
+#endif
+};
+
+typedef YUVPack_8888<16, 0, 0x00000000> YUVPack_XRGB8888;
+typedef YUVPack_8888<0, 16, 0x00000000> YUVPack_XBGR8888;
+typedef YUVPack_8888<16, 0, 0xFF000000> YUVPack_ARGB8888;
+typedef YUVPack_16<11, 5, 0, 6>         YUVPack_RGB565;
+typedef YUVPack_16<0, 5, 11, 6>         YUVPack_BGR565;
+typedef YUVPack_16<10, 5, 0, 5>         YUVPack_XRGB1555;
+typedef YUVPack_16<0, 5, 10, 5>         YUVPack_XBGR1555;
+
+// converts a row of video starting at the first pixel of a pair
+
+template <class Layout, class Pack>
+inline void convert_YUV(const integer8 y[], const integer8 u[], const integer8 v[], void* output, unsigned int count, const YUVCoefficients& k)
+{
+    typename Pack::Type* destination = static_cast<typename Pack::Type*>(output);
+
+    unsigned int offset = 0;
+
+#ifdef PIXELTOASTER_USE_SSE2
+    const unsigned int numBlocks = count / 8;
+
+    for (unsigned int i = 0; i < numBlocks; ++i)
+    {
+        __m128i luma, cb, cr, r, g, b;
+
+        Layout::load(y, u, v, 8 * i, luma, cb, cr);
+        yuv_to_rgb(luma, cb, cr, k, r, g, b);
+        Pack::store(destination + 8 * i, r, g, b);
+    }
+
+    offset = 8 * numBlocks;
+#endif
+
+    for (unsigned int i = offset; i < count; ++i)
+    {
+        int r, g, b;
+
+        yuv_to_rgb(y[i * Layout::lumaStep], u[i / 2 * Layout::chromaStep], v[i / 2 * Layout::chromaStep], k, r, g, b);
+
+        destination[i] = Pack::pack(r, g, b);
+    }
+}
+
+// the planes of a frame of video packed without padding in one block of memory, false if the format is not video
+
+inline bool videoPlanes(Format format, const void* pixels, int width, int height, const void* planes[3], int pitches[3])
+{
+    const integer8* frame        = static_cast<const integer8*>(pixels);
+    const int       chromaWidth  = (width + 1) / 2;
+    const int       chromaHeight = (height + 1) / 2;
+
+    switch (format)
+    {
+        case Format::I420:
+            pitches[0] = width;
+            pitches[1] = chromaWidth;
+            pitches[2] = chromaWidth;
+            planes[0]  = frame;
+            planes[1]  = frame + width * height;
+            planes[2]  = frame + width * height + chromaWidth * chromaHeight;
+            return true;
+
+        case Format::NV12:
+            pitches[0] = width;
+            pitches[1] = chromaWidth * 2;
+            planes[0]  = frame;
+            planes[1]  = frame + width * height;
+            return true;
+
+        case Format::YUY2:
+            pitches[0] = chromaWidth * 4;
+            planes[0]  = frame;
+            return true;
+
+        default: return false;
+    }
+}
+
+// byte order swapping routines, for display servers with the other byte order.
+// with sse2 the bytes are swapped with shifts, eight 16 bit pixels or four 32 bit pixels at a time.
+
+inline void swap_bytes(const integer16 source[], integer16 destination[], unsigned int count)
+{
+    unsigned int offset = 0;
+
+#ifdef PIXELTOASTER_USE_SSE2
+    const unsigned int numBlocks = count / 8;
+
+    for (unsigned int i = 0; i < numBlocks; ++i)
+    {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&source[8 * i]));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&destination[8 * i]), _mm_or_si128(_mm_slli_epi16(pixels, 8), _mm_srli_epi16(pixels, 8)));
+    }
+
+    offset = 8 * numBlocks;
+#endif
+
+    for (unsigned int i = offset; i < count; ++i)
+        destination[i] = (integer16)((source[i] << 8) | (source[i] >> 8));
+}
+
+inline void swap_bytes(const integer32 source[], integer32 destination[], unsigned int count)
+{
+    unsigned int offset = 0;
+
+#ifdef PIXELTOASTER_USE_SSE2
+    const unsigned int numBlocks = count / 4;
+
+    for (unsigned int i = 0; i < numBlocks; ++i)
+    {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&source[4 * i]));
+
+        // swap the halves, then the bytes of each half
+
+        pixels = _mm_or_si128(_mm_slli_epi32(pixels, 16), _mm_srli_epi32(pixels, 16));
+        pixels = _mm_or_si128(_mm_slli_epi16(pixels, 8), _mm_srli_epi16(pixels, 8));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&destination[4 * i]), pixels);
+    }
+
+    offset = 4 * numBlocks;
+#endif
+
+    for (unsigned int i = offset; i < count; ++i)
+    {
+        const integer32 color = source[i];
+        destination[i]        = (color << 24) | ((color & 0x0000FF00) << 8) | ((color >> 8) & 0x0000FF00) | (color >> 24);
+    }
+}
+
+// copy converters
+
+inline void convert_XRGB8888_to_XRGB8888(const integer32 source[], integer32 destination[], unsigned int count)
+{
+#ifndef PIXELTOASTER_NO_CRT
+    memcpy(destination, source, count * 4);
+#else
+    for (unsigned int i = 0; i < count; ++i)
+        destination[i] = source[i];
+#endif
+}
+
+inline void convert_XBGRFFFF_to_XBGRFFFF(const Pixel source[], Pixel destination[], unsigned int count)
+{
+#ifndef PIXELTOASTER_NO_CRT
+    memcpy(destination, source, count * 16);
+#else
+    for (unsigned int i = 0; i < count; ++i)
+        destination[i] = source[i];
+#endif
+}
+
+// size of a pixel in bytes, or zero if the format is unknown
+
+inline int pixelSize(Format format)
+{
+    switch (format)
+    {
+        case Format::XRGB8888:
+        case Format::XBGR8888:
+        case Format::ARGB8888:
+        case Format::XRGB2101010:
+        case Format::XBGR2101010: return 4;
+        case Format::RGB888:
+        case Format::BGR888: return 3;
+        case Format::RGB565:
+        case Format::BGR565:
+        case Format::XRGB1555:
+        case Format::XBGR1555: return 2;
+        case Format::XBGRFFFF: return 16;
+        case Format::Indexed8: return 1;
+        default: return 0;
+    }
+}
+
+// declare set of converter classes
+
+class ConverterAdapter : public Converter
+{
+    virtual void begin() override {}
+    virtual void end() override {}
+
+public:
+    // convert count pixels through truecolor a chunk at a time, so the truecolor pixels never leave the cache.
+    // row(first, chunk, chunkCount) converts the pixels from first on to truecolor, chain takes them to size byte pixels.
+
+    template <typename Row>
+    static void convertChained(Row row, Converter* chain, void* destination, int size, int count)
+    {
+        char*     output = static_cast<char*>(destination);
+        integer32 chunk[chunkSize];
+
+        for (int i = 0; i < count; i += chunkSize)
+        {
+            const int chunkCount = i + chunkSize < count ? chunkSize : count - i;
+            row(i, chunk, chunkCount);
+            chain->convert(chunk, output + i * size, chunkCount);
+        }
+    }
+
+private:
+    enum
+    {
+        chunkSize = 1024 // pixels, small enough to stay in the cache
+    };
+};
+
+#define PIXELTOASTER_CONVERTER(type, source_type, destination_type)                             \
+                                                                                                \
+    class Converter_##type : public ConverterAdapter                                            \
+    {                                                                                           \
+        void convert(const void* source, void* destination, int pixels)                         \
+        {                                                                                       \
+            convert_##type((const source_type*)source, (destination_type*)destination, pixels); \
+        }                                                                                       \
+    };
+
+PIXELTOASTER_CONVERTER(XBGRFFFF_to_XBGRFFFF, Pixel, Pixel);
+PIXELTOASTER_CONVERTER(XBGRFFFF_to_XRGB8888, Pixel, integer32);
+PIXELTOASTER_CONVERTER(XBGRFFFF_to_XBGR8888, Pixel, integer32);
+PIXELTOASTER_CONVERTER(XBGRFFFF_to_RGB888, Pixel, integer8);
+PIXELTOASTER_CONVERTER(XBGRFFFF_to_BGR888, Pixel, integer8);
+PIXELTOASTER_CONVERTER(XBGRFFFF_to_RGB565, Pixel, integer16);
+PIXELTOASTER_CONVERTER(XBGRFFFF_to_BGR565, Pixel, integer16);
+PIXELTOASTER_CONVERTER(XBGRFFFF_to_XRGB1555, Pixel, integer16);
+PIXELTOASTER_CONVERTER(XBGRFFFF_to_XBGR1555, Pixel, integer16);
+PIXELTOASTER_CONVERTER(XBGRFFFF_to_ARGB8888, Pixel, integer32);
+PIXELTOASTER_CONVERTER(XBGRFFFF_to_XRGB2101010, Pixel, integer32);
+PIXELTOASTER_CONVERTER(XBGRFFFF_to_XBGR2101010, Pixel, integer32);
+
+PIXELTOASTER_CONVERTER(XRGB8888_to_XBGRFFFF, integer32, Pixel);
+PIXELTOASTER_CONVERTER(XRGB8888_to_XRGB8888, integer32, integer32);
+PIXELTOASTER_CONVERTER(XRGB8888_to_XBGR8888, integer32, integer32);
+PIXELTOASTER_CONVERTER(XRGB8888_to_RGB888, integer32, integer8);
+PIXELTOASTER_CONVERTER(XRGB8888_to_BGR888, integer32, integer8);
+PIXELTOASTER_CONVERTER(XRGB8888_to_RGB565, integer32, integer16);
+PIXELTOASTER_CONVERTER(XRGB8888_to_BGR565, integer32, integer16);
+PIXELTOASTER_CONVERTER(XRGB8888_to_XRGB1555, integer32, integer16);
+PIXELTOASTER_CONVERTER(XRGB8888_to_XBGR1555, integer32, integer16);
+PIXELTOASTER_CONVERTER(XRGB8888_to_ARGB8888, integer32, integer32);
+PIXELTOASTER_CONVERTER(XRGB8888_to_opaque_ARGB8888, integer32, integer32);
+PIXELTOASTER_CONVERTER(XRGB8888_to_XRGB2101010, integer32, integer32);
+PIXELTOASTER_CONVERTER(XRGB8888_to_XBGR2101010, integer32, integer32);
+
+PIXELTOASTER_CONVERTER(XBGR8888_to_XRGB8888, integer32, integer32);
+PIXELTOASTER_CONVERTER(RGB888_to_XRGB8888, integer8, integer32);
+PIXELTOASTER_CONVERTER(BGR888_to_XRGB8888, integer8, integer32);
+PIXELTOASTER_CONVERTER(RGB565_to_XRGB8888, integer16, integer32);
+PIXELTOASTER_CONVERTER(BGR565_to_XRGB8888, integer16, integer32);
+PIXELTOASTER_CONVERTER(XRGB1555_to_XRGB8888, integer16, integer32);
+PIXELTOASTER_CONVERTER(XBGR1555_to_XRGB8888, integer16, integer32);
+PIXELTOASTER_CONVERTER(XRGB2101010_to_XRGB8888, integer32, integer32);
+PIXELTOASTER_CONVERTER(XBGR2101010_to_XRGB8888, integer32, integer32);
+
+#undef PIXELTOASTER_CONVERTER
+
+// converts palette indices with the palette converted to the destination format.
+// unlike the converters above this one holds state, so each display needs its own.
+
+class Converter_Indexed8 : public ConverterAdapter
+{
+public:
+    Converter_Indexed8()
+    {
+        _size = 0;
+
+        // note: some converters leave components they do not have alone
+
+        for (int i = 0; i < 256 * maximumSize; ++i)
+            _table[i] = 0;
+    }
+
+    // convert the entries first to first + count of all 256 truecolor colors to destination pixels of the given size in bytes.
+    // the other entries keep their last conversion, unless the size changed and the whole palette has to be converted.
+
+    void palette(const TrueColorPixel colors[], int first, int count, Converter* converter, int size)
+    {
+        if (size != _size)
+        {
+            first = 0;
+            count = 256;
+        }
+
+        _size = size > 0 && size <= maximumSize ? size : 0;
+
+        if (first < 0 || first >= 256 || !converter || !_size)
+            return;
+
+        if (first + count > 256)
+            count = 256 - first;
+
+        converter->convert(colors + first, _table + first * _size, count);
+    }
+
+    void convert(const void* source, void* destination, int pixels) override
+    {
+        const integer8* indices = static_cast<const integer8*>(source);
+
+        switch (_size)
+        {
+            case 2: convert_Indexed8(indices, (integer16*)destination, (const integer16*)_table, pixels); break;
+            case 4: convert_Indexed8(indices, (integer32*)destination, (const integer32*)_table, pixels); break;
+            case 16: convert_Indexed8(indices, (Pixel*)destination, (const Pixel*)_table, pixels); break;
+            default: convert_Indexed8(indices, (integer8*)destination, _table, pixels, _size); break;
+        }
+    }
+
+private:
+    enum
+    {
+        maximumSize = 16 // bytes per destination pixel, enough for floating point
+    };
+
+    alignas(16) integer8 _table[256 * maximumSize];
+    int _size;
+};
+
+// converts with another converter and swaps the bytes of the converted pixels, for display servers
+// with the other byte order. the pixels are swapped a block at a time right after they are converted,
+// while they are still in the cache. without another converter the pixels are just swapped.
+
+class Converter_Swapped : public ConverterAdapter
+{
+public:
+    Converter_Swapped()
+    {
+        _converter  = nullptr;
+        _sourceSize = 0;
+        _size       = 0;
+    }
+
+    // swap the pixels the converter makes from source pixels of the given size, both sizes in bytes.
+    // note: only 16 and 32 bit pixels are swapped, the displays have no others.
+
+    void select(Converter* converter, int sourceSize, int size)
+    {
+        _converter  = converter;
+        _sourceSize = converter ? sourceSize : size;
+        _size       = size;
+    }
+
+    void convert(const void* source, void* destination, int pixels) override
+    {
+        const char* input  = static_cast<const char*>(source);
+        char*       output = static_cast<char*>(destination);
+
+        for (int i = 0; i < pixels; i += blockSize)
+        {
+            const int   count = i + blockSize < pixels ? blockSize : pixels - i;
+            const char* block = input + i * _sourceSize;
+            char*       dest  = output + i * _size;
+
+            if (_converter)
+            {
+                _converter->convert(block, dest, count);
+                block = dest;
+            }
+
+            if (_size == 2)
+                swap_bytes((const integer16*)block, (integer16*)dest, count);
+            else if (_size == 4)
+                swap_bytes((const integer32*)block, (integer32*)dest, count);
+        }
+    }
+
+private:
+    enum
+    {
+        blockSize = 1024 // pixels, small enough to stay in the cache
+    };
+
+    Converter* _converter;
+    int        _sourceSize; // bytes per source pixel
+    int        _size;       // bytes per destination pixel
+};
+
+// converts floating point pixels quickly, see Quality::Fast.
+// formats with 16 or 24 bits per pixel are converted through truecolor, the others exactly.
+
+class Converter_Fast : public ConverterAdapter
+{
+public:
+    Converter_Fast()
+    {
+        _fast  = nullptr;
+        _exact = nullptr;
+        _chain = nullptr;
+        _size  = 0;
+    }
+
+    // get ready to convert floating point pixels to the destination format, false if we can't
+
+    bool select(Format destination)
+    {
+        _size  = pixelSize(destination);
+        _fast  = fast(destination);
+        _exact = nullptr;
+        _chain = nullptr;
+
+        if (!_fast && fast(Format::XRGB8888) && (_size == 2 || _size == 3))
+        {
+            _chain = requestConverter(Format::XRGB8888, destination);
+            _fast  = _chain ? fast(Format::XRGB8888) : nullptr;
+        }
+
+        if (!_fast)
+            _exact = requestConverter(Format::XBGRFFFF, destination);
+
+        return _fast || _exact;
+    }
+
+    void convert(const void* source, void* destination, int pixels) override
+    {
+        const Pixel* input = static_cast<const Pixel*>(source);
+        const Fast   fast  = _fast;
+
+        if (_exact)
+        {
+            _exact->convert(source, destination, pixels);
+            return;
+        }
+
+        if (!_chain)
+        {
+            _fast(input, static_cast<integer32*>(destination), pixels);
+            return;
+        }
+
+        convertChained([input, fast](int first, integer32 chunk[], int count) { fast(input + first, chunk, count); },
+                       _chain, destination, _size, pixels);
+    }
+
+private:
+    typedef void (*Fast)(const Pixel source[], integer32 destination[], unsigned int count);
+
+    // note: without sse2 the exact converters are as quick
+
+    static Fast fast(Format destination)
+    {
+        switch (destination)
+        {
+#ifdef PIXELTOASTER_USE_SSE2
+            case Format::XRGB8888: return convert_XBGRFFFF_to_XRGB8888_fast;
+            case Format::XBGR8888: return convert_XBGRFFFF_to_XBGR8888_fast;
+#endif
+            default: return nullptr;
+        }
+    }
+
+    Fast       _fast;  // converts to our format, or to truecolor when chained
+    Converter* _exact; // converts to our format when there is no fast way
+    Converter* _chain; // converts truecolor to our format
+    int        _size;  // bytes per destination pixel
+};
+
+// converts frames of video, see convert_YUV.
+// video is split over planes and shares chroma between rows, so rows are converted from a place in the frame
+// rather than from a run of pixels. formats without a routine of their own are converted through truecolor.
+
+class Converter_YUV
+{
+public:
+    Converter_YUV()
+    {
+        _row   = nullptr;
+        _chain = nullptr;
+        _size  = 0;
+        _coefficients = yuvCoefficients(ColorSpace::BT601);
+    }
+
+    // get ready to convert video in the source format and color space to the destination format, false if we can't
+
+    bool select(Format source, ColorSpace colorSpace, Format destination)
+    {
+        _source       = source;
+        _coefficients = yuvCoefficients(colorSpace);
+        _size         = pixelSize(destination);
+        _row          = row(source, destination);
+        _chain        = nullptr;
+
+        if (!_row && row(source, Format::XRGB8888))
+        {
+            _chain = requestConverter(Format::XRGB8888, destination);
+            _row   = _chain ? row(source, Format::XRGB8888) : nullptr;
+        }
+
+        return _row != nullptr;
+    }
+
+    // convert count pixels of row y of the frame starting at column x
+
+    void convert(const void* const planes[], const int pitches[], int x, int y, void* destination, int count)
+    {
+        char* output = static_cast<char*>(destination);
+
+        if (count <= 0)
+            return;
+
+        if (x & 1)
+        {
+            // the pixel shares chroma with the one before it, so convert the pair and keep the second
+
+            char pair[2 * 16] = {0};
+
+            convert(planes, pitches, x - 1, y, pair, 2);
+
+            for (int i = 0; i < _size; ++i)
+                output[i] = pair[_size + i];
+
+            output += _size;
+            ++x;
+            --count;
+        }
+
+        const integer8* luma = static_cast<const integer8*>(planes[0]) + y * pitches[0];
+        const integer8* u    = nullptr;
+        const integer8* v    = nullptr;
+
+        switch (_source)
+        {
+            case Format::I420:
+                luma += x;
+                u = static_cast<const integer8*>(planes[1]) + y / 2 * pitches[1] + x / 2;
+                v = static_cast<const integer8*>(planes[2]) + y / 2 * pitches[2] + x / 2;
+                break;
+
+            case Format::NV12:
+                luma += x;
+                u = static_cast<const integer8*>(planes[1]) + y / 2 * pitches[1] + x;
+                v = u + 1;
+                break;
+
+            default:
+                luma += x * 2;
+                u = luma + 1;
+                v = luma + 3;
+                break;
+        }
+
+        if (!_chain)
+        {
+            _row(luma, u, v, output, count, _coefficients);
+            return;
+        }
+
+        // note: chunks are a whole number of pairs, so each starts on the first pixel of a pair
+
+        const Row              row        = _row;
+        const YUVCoefficients& k          = _coefficients;
+        const int              lumaStep   = _source == Format::YUY2 ? 2 : 1;
+        const int              chromaStep = _source == Format::I420 ? 1 : _source == Format::NV12 ? 2 : 4;
+
+        ConverterAdapter::convertChained([=, &k](int first, integer32 chunk[], int count) {
+            row(luma + first * lumaStep, u + first / 2 * chromaStep, v + first / 2 * chromaStep, chunk, count, k);
+        }, _chain, output, _size, count);
+    }
+
+private:
+    typedef void (*Row)(const integer8 y[], const integer8 u[], const integer8 v[], void* destination, unsigned int count, const YUVCoefficients& k);
+
+    static Row row(Format source, Format destination)
+    {
+        switch (source)
+        {
+            case Format::I420: return row<YUVLayout_I420>(destination);
+            case Format::NV12: return row<YUVLayout_NV12>(destination);
+            case Format::YUY2: return row<YUVLayout_YUY2>(destination);
+            default: return nullptr;
+        }
+    }
+
+    template <class Layout>
+    static Row row(Format destination)
+    {
+        switch (destination)
+        {
+            case Format::XRGB8888: return &convert_YUV<Layout, YUVPack_XRGB8888>;
+            case Format::XBGR8888: return &convert_YUV<Layout, YUVPack_XBGR8888>;
+            case Format::ARGB8888: return &convert_YUV<Layout, YUVPack_ARGB8888>;
+            case Format::RGB565: return &convert_YUV<Layout, YUVPack_RGB565>;
+            case Format::BGR565: return &convert_YUV<Layout, YUVPack_BGR565>;
+            case Format::XRGB1555: return &convert_YUV<Layout, YUVPack_XRGB1555>;
+            case Format::XBGR1555: return &convert_YUV<Layout, YUVPack_XBGR1555>;
+            default: return nullptr;
+        }
+    }
+
+    Format          _source;
+    YUVCoefficients _coefficients;
+    Row             _row;
+    Converter*      _chain; // converts truecolor to the destination format when there is no routine of its own
+    int             _size;  // bytes per destination pixel
+};
 } // namespace PixelToaster
 
 #endif
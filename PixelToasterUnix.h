@@ -11,22 +11,165 @@
 #define XK_MISCELLANY
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <X11/Xlib.h>
+#include <X11/Xatom.h>
 #include <X11/XKBlib.h>
 #include <X11/Xutil.h>
+#include <X11/Xresource.h>
 #include <X11/keysymdef.h>
 
+#if defined(PIXELTOASTER_USE_PRESENT) || defined(PIXELTOASTER_USE_RANDR)
+#    include <X11/Xlib-xcb.h>
+#endif
+
+#ifdef PIXELTOASTER_USE_PRESENT
+#    include <xcb/present.h>
+#endif
+
+#ifdef PIXELTOASTER_USE_RANDR
+#    include <xcb/randr.h>
+#endif
+
 namespace PixelToaster {
+// memory for pixels, aligned to a cache line.
+//
+// allocations of a huge page and up are mapped in whole huge pages and start right on a huge
+// page boundary: from the reserved huge page pool if the system has one, otherwise as ordinary
+// memory the kernel is asked to back with transparent huge pages. everything else comes from
+// posix_memalign.
+//
+// the size of each mapping is kept in a list on the side, so freeing knows how much to unmap
+// without a header in front of the pixels.
+
+static const size_t pixelAlignment = 64;
+static const size_t hugePageSize   = 2 * 1024 * 1024;
+
+struct HugePageMapping
+{
+    void*            memory;
+    size_t           size;
+    HugePageMapping* next;
+};
+
+static HugePageMapping* hugePageMappings    = nullptr;
+static pthread_mutex_t  hugePageMappingLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void* allocatePixelMemory(size_t bytes)
+{
+    if (bytes < hugePageSize)
+    {
+        // note: zero bytes still gets a cache line of its own, so the pointer is unique and never null
+
+        void* memory = nullptr;
+        if (::posix_memalign(&memory, pixelAlignment, bytes ? bytes : pixelAlignment) != 0)
+            return nullptr;
+
+        return memory;
+    }
+
+    HugePageMapping* mapping = static_cast<HugePageMapping*>(::malloc(sizeof(HugePageMapping)));
+    if (!mapping)
+        return nullptr;
+
+    const size_t size = (bytes + hugePageSize - 1) & ~(hugePageSize - 1);
+
+    void* memory = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+
+    if (memory == MAP_FAILED)
+    {
+        // note: the kernel only uses huge pages for whole aligned huge pages, so map one extra and trim to alignment
+
+        char* mapped = static_cast<char*>(::mmap(nullptr, size + hugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (mapped == MAP_FAILED)
+        {
+            ::free(mapping);
+            return nullptr;
+        }
+
+        char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(mapped) + hugePageSize - 1) & ~(uintptr_t)(hugePageSize - 1));
+        if (aligned != mapped)
+            ::munmap(mapped, aligned - mapped);
+        if (aligned - mapped != (ptrdiff_t)hugePageSize)
+            ::munmap(aligned + size, hugePageSize - (aligned - mapped));
+
+#ifdef MADV_HUGEPAGE
+        ::madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+
+        memory = aligned;
+    }
+
+    mapping->memory = memory;
+    mapping->size   = size;
+
+    pthread_mutex_lock(&hugePageMappingLock);
+    mapping->next    = hugePageMappings;
+    hugePageMappings = mapping;
+    pthread_mutex_unlock(&hugePageMappingLock);
+
+    return memory;
+}
+
+static void freePixelMemory(void* pixels)
+{
+    if (!pixels)
+        return;
+
+    // only huge page mappings start on a huge page boundary for sure, so only those need looking up
+
+    if ((reinterpret_cast<uintptr_t>(pixels) & (hugePageSize - 1)) == 0)
+    {
+        HugePageMapping* mapping = nullptr;
+
+        pthread_mutex_lock(&hugePageMappingLock);
+        for (HugePageMapping** link = &hugePageMappings; *link; link = &(*link)->next)
+        {
+            if ((*link)->memory == pixels)
+            {
+                mapping = *link;
+                *link   = mapping->next;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&hugePageMappingLock);
+
+        if (mapping)
+        {
+            ::munmap(mapping->memory, mapping->size);
+            ::free(mapping);
+            return;
+        }
+    }
+
+    ::free(pixels);
+}
+
 template <typename T>
 class DirtyVector
 {
 public:
-    explicit DirtyVector(size_t size = 0) { data_ = size == 0 ? nullptr : (static_cast<T*>(malloc(size * sizeof(T)))); }
+    explicit DirtyVector(size_t size = 0)
+    {
+        data_     = size == 0 ? nullptr : (static_cast<T*>(allocatePixelMemory(size * sizeof(T))));
+        capacity_ = data_ ? size : 0;
+    }
     ~DirtyVector()
     {
         if (data_ != nullptr)
         {
-            free(data_);
+            freePixelMemory(data_);
             data_ = nullptr;
         }
     }
@@ -35,6 +178,16 @@ public:
         DirtyVector<T> temp(size);
         swap(temp);
     }
+    // make room for at least size elements, keeping the storage if it is big enough already.
+    // grows geometrically, so something resized a little at a time rarely reallocates.
+    // note: like reset, this does not keep the elements
+    bool reserve(size_t size)
+    {
+        if (size <= capacity_)
+            return true;
+        reset(size > 2 * capacity_ ? size : 2 * capacity_);
+        return !isEmpty();
+    }
     T& operator[](size_t i)
     {
         assert(data_);
@@ -47,10 +200,15 @@ public:
         T* temp     = data_;
         data_       = other.data_;
         other.data_ = temp;
+
+        size_t capacity = capacity_;
+        capacity_       = other.capacity_;
+        other.capacity_ = capacity;
     }
 
 private:
-    T* data_;
+    T*     data_;
+    size_t capacity_;
 };
 
 static Format findFormat(int bitsPerPixel, unsigned long redMask, unsigned long greenMask, unsigned long blueMask)
@@ -78,400 +236,150 @@ static Format findFormat(int bitsPerPixel, unsigned long redMask, unsigned long
                 return Format::XRGB8888;
             if (redMask == 0x0000ff && greenMask == 0x00ff00 && blueMask == 0xff0000)
                 return Format::XBGR8888;
+            if (redMask == 0x3ff00000 && greenMask == 0x000ffc00 && blueMask == 0x000003ff)
+                return Format::XRGB2101010;
+            if (redMask == 0x000003ff && greenMask == 0x000ffc00 && blueMask == 0x3ff00000)
+                return Format::XBGR2101010;
             break;
     }
     return Format::Unknown;
 }
 
-class UnixDisplay : public DisplayAdapter
-{
-public:
-    UnixDisplay()
-    {
-        defaults();
-    }
-
-    bool open(const char title[], int width, int height, Output output, Mode mode) override
-    {
-        DisplayAdapter::open(title, width, height, output, mode);
+// seconds on a clock that never jumps, for timeouts
 
-        // let's open a display
+static double monotonicTime()
+{
+    timespec time;
+    if (clock_gettime(CLOCK_MONOTONIC, &time) != 0)
+        return 0.0;
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
 
-        display_ = ::XOpenDisplay(0);
-        if (!display_)
-        {
-            close();
-            return false;
-        }
+// wait until there is something to read on a file descriptor.
+// a negative deadline waits forever, otherwise gives up at that monotonic time.
 
-        const int screen = DefaultScreen(display_);
-        ::Visual* visual = DefaultVisual(display_, screen);
-        if (!visual)
-        {
-            close();
-            return false;
-        }
+static bool waitReadable(int fd, double deadline)
+{
+    while (true)
+    {
+        int milliseconds = -1;
 
-        // It gets messy when talking about color depths.
-        //
-        // For the image buffer, we either need 8, 16 or 32 bitsPerPixel.  8 bits we'll
-        // never have (hopefully), 16 bits will be used for displayDepth 15 & 16, and
-        // 32 bits must be used for depths 24 and 32.
-        //
-        // The converters will get this right when talking about displayDepth 15 & 16, but
-        // it will wrongly assume that displayDepth 24 takes _exactly_ 24 bitsPerPixel.  We
-        // solve that by tricking the converter requester by presenting it a 32 bit
-        // bufferDepth instead.
-        //
-        const int displayDepth  = DefaultDepth(display_, screen);
-        const int bufferDepth   = displayDepth == 24 ? 32 : displayDepth;
-        const int bytesPerPixel = (bufferDepth + 7) / 8;
-        const int bitsPerPixel  = 8 * bytesPerPixel;
-        if (bitsPerPixel != 16 && bitsPerPixel != 32)
+        if (deadline >= 0.0)
         {
-            close();
-            return false;
-        }
+            const double remaining = deadline - monotonicTime();
+            if (remaining <= 0.0)
+                return false;
 
-        destFormat_             = findFormat(bufferDepth,
-                                 visual->red_mask, visual->green_mask, visual->blue_mask);
-        floatingPointConverter_ = requestConverter(Format::XBGRFFFF, destFormat_);
-        trueColorConverter_     = requestConverter(Format::XRGB8888, destFormat_);
-        if (!floatingPointConverter_ || !trueColorConverter_)
-        {
-            close();
-            return false;
+            // note: round up, waking just before the deadline would only make us poll again
+            milliseconds = static_cast<int>(remaining * 1000.0) + 1;
         }
 
-        // let's create a window
-
-        const Window root = DefaultRootWindow(display_);
-
-        const int screenWidth  = DisplayWidth(display_, screen);
-        const int screenHeight = DisplayHeight(display_, screen);
-        const int left         = (screenWidth - width) / 2;
-        const int top          = (screenHeight - height) / 2;
-
-        ::XSetWindowAttributes attributes;
-        attributes.border_pixel = attributes.background_pixel = BlackPixel(display_, screen);
-        attributes.backing_store                              = NotUseful;
-
-        window_ = ::XCreateWindow(display_, root, left, top, width, height, 0,
-                                  displayDepth, InputOutput, visual,
-                                  CWBackPixel | CWBorderPixel | CWBackingStore, &attributes);
-
-        ::XStoreName(display_, window_, title);
+        ::pollfd descriptor;
+        descriptor.fd      = fd;
+        descriptor.events  = POLLIN;
+        descriptor.revents = 0;
 
-        wmProtocols_    = XInternAtom(display_, "WM_PROTOCOLS", True);
-        wmDeleteWindow_ = XInternAtom(display_, "WM_DELETE_WINDOW", True);
-        if (wmProtocols_ == 0 || wmDeleteWindow_ == 0)
-        {
-            close();
-            return false;
-        }
-        if (::XSetWMProtocols(display_, window_, &wmDeleteWindow_, 1) == 0)
-        {
-            close();
+        const int result = ::poll(&descriptor, 1, milliseconds);
+        if (result > 0)
+            return true;
+        if (result < 0 && errno != EINTR)
             return false;
-        }
+    }
+}
 
-        ::XSizeHints sizeHints;
-        sizeHints.flags = PPosition | PMinSize | PMaxSize;
-        sizeHints.x = sizeHints.y = 0;
-        sizeHints.min_width = sizeHints.max_width = width;
-        sizeHints.min_height = sizeHints.max_height = height;
-        ::XSetNormalHints(display_, window_, &sizeHints);
-        ::XClearWindow(display_, window_);
-        ::XSelectInput(display_, window_, eventMask_);
+// scale a rectangle of pixels up by a whole factor, each pixel becoming a square of scale x scale pixels.
+// the destination is the whole source scaled, the rectangle lands at the same place scaled.
+// note: source rows are pitch pixels apart, the destination rows are packed.
 
-        // create (image) buffer
+template <typename T>
+static void scalePixels(const T* source, int pitch, T* dest, int sourceWidth, int x, int y, int w, int h, int scale)
+{
+    const int destWidth = sourceWidth * scale;
 
-        buffer_.reset(width * height * bytesPerPixel);
-        if (buffer_.isEmpty())
-        {
-            close();
-            return false;
-        }
+    for (int row = y; row < y + h; ++row)
+    {
+        const T* in    = source + row * pitch + x;
+        T* const first = dest + row * scale * destWidth + x * scale;
+        T*       out   = first;
 
-        gc_    = DefaultGC(display_, screen);
-        image_ = ::XCreateImage(display_, CopyFromParent, displayDepth, ZPixmap, 0, 0,
-                                width, height, bitsPerPixel, width * bytesPerPixel);
-#if defined(PIXELTOASTER_LITTLE_ENDIAN)
-        image_->byte_order = LSBFirst;
-#else
-        image_->byte_order = MSBFirst;
-#endif
-        if (!image_)
+        for (int i = 0; i < w; ++i)
         {
-            close();
-            return false;
+            for (int k = 0; k < scale; ++k)
+                *out++ = in[i];
         }
 
-        // we have a winner!
-
-        ::XMapRaised(display_, window_);
-        ::XFlush(display_);
-
-        if (DisplayAdapter::listener())
-            DisplayAdapter::listener()->onOpen(wrapper() ? *wrapper() : *(DisplayInterface*)this);
+        // note: the other rows of the square are the same, copy them whole
 
-        return true;
+        for (int k = 1; k < scale; ++k)
+            memcpy(first + k * destWidth, first, w * scale * sizeof(T));
     }
+}
 
-    void close() override
-    {
-        if (image_)
-        {
-            XDestroyImage(image_);
-            image_ = 0;
-        }
-
-        if (display_ && window_)
-        {
-            XDestroyWindow(display_, window_);
-            window_ = 0;
-        }
+// move the part of a packed frame that stays in view when scrolling it by dx, dy.
+// the rows and columns scrolled into view keep whatever they held before.
 
-        if (display_)
-        {
-            XCloseDisplay(display_);
-            display_ = 0;
-        }
+static void moveFrame(char* frame, int width, int height, int bytesPerPixel, int dx, int dy)
+{
+    const int sourceX    = dx < 0 ? -dx : 0;
+    const int sourceY    = dy < 0 ? -dy : 0;
+    const int destX      = dx > 0 ? dx : 0;
+    const int destY      = dy > 0 ? dy : 0;
+    const int keptWidth  = width - sourceX - destX;
+    const int keptHeight = height - sourceY - destY;
+    const int rowSize    = width * bytesPerPixel;
 
-        DisplayAdapter::close(); // note: this calls our virtual defaults method
-    }
+    // move the rows in the order that does not overwrite rows still to move
 
-    bool update(const TrueColorPixel* trueColorPixels, const FloatingPointPixel* floatingPointPixels, const Rectangle* dirtyBox) override
+    for (int i = 0; i < keptHeight; ++i)
     {
-        if (isShuttingDown_)
-        {
-            close();
-            return false;
-        }
-
-        if (!display_ || !window_ || !image_)
-            return false;
+        const int row = dy > 0 ? keptHeight - 1 - i : i;
+        memmove(frame + (destY + row) * rowSize + destX * bytesPerPixel,
+                frame + (sourceY + row) * rowSize + sourceX * bytesPerPixel,
+                keptWidth * bytesPerPixel);
+    }
+}
 
-        const int w    = width();
-        const int h    = height();
-        const int size = w * h;
+// a pixel of a packed 24 bit frame, for scaling them a whole pixel at a time
 
-        const bool shortcut = trueColorPixels != nullptr && destFormat_ == Format::XRGB8888;
+struct Packed24
+{
+    char bytes[3];
+};
 
-        if (!shortcut)
-        {
-            // extra conversion step: copy pixels to buffer
+// translates x11 keysyms into key codes.
+// shared by every display that talks to an x server.
 
-            if (trueColorPixels)
-                trueColorConverter_->convert(trueColorPixels, buffer_.get(), size);
-            else if (floatingPointPixels)
-                floatingPointConverter_->convert(floatingPointPixels, buffer_.get(), size);
-            else
-                return false;
+class UnixKeyMap
+{
+public:
+    static Key translate(unsigned long keySym)
+    {
+        const int hiSym = (keySym & 0xff00) >> 8;
+        const int loSym = keySym & 0xff;
 
-            image_->data = buffer_.get();
-        }
-        else
+        switch (hiSym)
         {
-            // shortcut: avoid extra copy - only works for truecolor pixels
-
-            image_->data = (char*)trueColorPixels;
+            case 0x00: return normalKeys_[loSym];
+            case 0xff: return functionKeys_[loSym];
         }
 
-        ::XPutImage(display_, window_, gc_, image_, 0, 0, 0, 0, w, h);
-        ::XFlush(display_);
-
-        image_->data = nullptr;
-
-        pumpEvents();
-
-        return true;
-    }
-
-    void title(const char title[]) override
-    {
-        DisplayAdapter::title(title);
-
-        if (display_ && window_)
-            ::XStoreName(display_, window_, title);
-    }
-
-protected:
-    void defaults() override
-    {
-        DisplayAdapter::defaults();
-
-        display_ = 0;
-        window_  = 0;
-        gc_      = 0;
-        image_   = 0;
-        buffer_.reset();
-        trueColorConverter_     = 0;
-        floatingPointConverter_ = 0;
-        isShuttingDown_         = false;
-        Format destFormat_      = Format::Unknown;
+        return Key::Undefined;
     }
 
 private:
     enum
     {
-        eventMask_  = KeyPressMask | KeyReleaseMask | ButtonPressMask | ButtonReleaseMask | PointerMotionMask | ButtonMotionMask,
         keyMapSize_ = 256
     };
 
-    typedef DirtyVector<char> TBuffer;
-    typedef Key::Code         TKeyMap[keyMapSize_];
-    typedef bool              TKeyFlags[keyMapSize_];
+    typedef Key::Code TKeyMap[keyMapSize_];
 
-    void pumpEvents()
+    static bool initialize()
     {
-        ::XEvent event;
-        while (true)
-        {
-            if (::XCheckWindowEvent(display_, window_, -1, &event))
-            {
-                handleEvent(event);
-            }
-            else if (::XCheckTypedEvent(display_, ClientMessage, &event))
-            {
-                handleEvent(event);
-            }
-            else
-            {
-                break;
-            }
-        }
-
-        // send key press and up events
-
         for (int i = 0; i < keyMapSize_; ++i)
         {
-            if (keyIsReleased_[i] && keyIsPressed_[i])
-            {
-                if (listener())
-                    listener()->onKeyUp(wrapper() ? *wrapper() : *(DisplayInterface*)this, static_cast<Key::Code>(i));
-                keyIsPressed_[i]  = false;
-                keyIsReleased_[i] = false;
-            }
-            else if (keyIsPressed_[i])
-            {
-                if (listener())
-                    listener()->onKeyPressed(wrapper() ? *wrapper() : *(DisplayInterface*)this, static_cast<Key::Code>(i));
-            }
-        }
-    }
-
-    void handleEvent(const ::XEvent& event)
-    {
-        switch (event.type)
-        {
-            case KeyPress:
-            case KeyRelease:
-            {
-                const KeySym keySym = ::XkbKeycodeToKeysym(display_, event.xkey.keycode, 0, 0);
-                const int    hiSym  = (keySym & 0xff00) >> 8;
-                const int    loSym  = keySym & 0xff;
-
-                Key key = Key::Undefined;
-                switch (hiSym)
-                {
-                    case 0x00:
-                        key = normalKeys_[loSym];
-                        break;
-                    case 0xff:
-                        key = functionKeys_[loSym];
-                        break;
-                }
-
-                if (event.type == KeyPress)
-                {
-                    if (!keyIsPressed_[key])
-                    {
-                        bool defaultKeyHandlers = true;
-
-                        if (listener())
-                        {
-                            listener()->onKeyDown(wrapper() ? *wrapper() : *(DisplayInterface*)this, key);
-                            defaultKeyHandlers = listener()->defaultKeyHandlers();
-                        }
-
-                        if (defaultKeyHandlers && key == Key::Escape)
-                        {
-                            isShuttingDown_ = true;
-                        }
-                    }
-                    keyIsPressed_[key]  = true;
-                    keyIsReleased_[key] = false;
-                }
-                else
-                {
-                    keyIsReleased_[key] = true;
-                }
-                break;
-            }
-
-            case ButtonPress:
-            case ButtonRelease:
-            {
-                Mouse mouse;
-                mouse.x              = static_cast<float>(event.xbutton.x);
-                mouse.y              = static_cast<float>(event.xbutton.y);
-                mouse.buttons.left   = event.xbutton.button == Button1;
-                mouse.buttons.middle = event.xbutton.button == Button2;
-                mouse.buttons.right  = event.xbutton.button == Button3;
-                if (event.type == ButtonPress)
-                {
-                    if (listener())
-                        listener()->onMouseButtonDown(wrapper() ? *wrapper() : *(DisplayInterface*)this, mouse);
-                }
-                else
-                {
-                    if (listener())
-                        listener()->onMouseButtonUp(wrapper() ? *wrapper() : *(DisplayInterface*)this, mouse);
-                }
-                break;
-            }
-            case MotionNotify:
-            {
-                Mouse mouse;
-                mouse.x              = static_cast<float>(event.xmotion.x);
-                mouse.y              = static_cast<float>(event.xmotion.y);
-                mouse.buttons.left   = event.xmotion.state & Button1Mask;
-                mouse.buttons.middle = event.xmotion.state & Button2Mask;
-                mouse.buttons.right  = event.xmotion.state & Button3Mask;
-                if (listener())
-                    listener()->onMouseMove(wrapper() ? *wrapper() : *(DisplayInterface*)this, mouse);
-                break;
-            }
-            case ClientMessage:
-            {
-                if (event.xclient.message_type == wmProtocols_ &&
-                    event.xclient.format == 32 &&
-                    event.xclient.data.l[0] == (long)wmDeleteWindow_)
-                {
-                    if (listener())
-                    {
-                        if (listener()->onClose(wrapper() ? *wrapper() : *(DisplayInterface*)this))
-                            isShuttingDown_ = true;
-                    }
-                    else
-                    {
-                        isShuttingDown_ = true;
-                    }
-                }
-                break;
-            }
-        }
-    }
-
-    static bool initializeKeyMaps()
-    {
-        for (int i = 0; i < keyMapSize_; ++i)
-        {
-            normalKeys_[i]    = Key::Undefined;
-            functionKeys_[i]  = Key::Undefined;
-            keyIsPressed_[i]  = false;
-            keyIsReleased_[i] = false;
+            normalKeys_[i]   = Key::Undefined;
+            functionKeys_[i] = Key::Undefined;
         }
 
         normalKeys_[XK_space]        = Key::Space;
@@ -617,30 +525,2614 @@ private:
         return true;
     }
 
-    ::Display* display_;
-    ::Window   window_;
-    ::GC       gc_;
-    ::XImage*  image_;
-    TBuffer    buffer_;
-    Converter* trueColorConverter_;
-    Converter* floatingPointConverter_;
-    bool       isShuttingDown_;
-    Format     destFormat_;
-    Atom       wmProtocols_;
-    Atom       wmDeleteWindow_;
-
-    static TKeyMap   normalKeys_;
-    static TKeyMap   functionKeys_;
-    static TKeyFlags keyIsPressed_;
-    static TKeyFlags keyIsReleased_;
-    static bool      keyMapsInitialized_;
+    static TKeyMap normalKeys_;
+    static TKeyMap functionKeys_;
+    static bool    initialized_;
+};
+
+// the keys held down on one display.
+//
+// pressed and released keys are kept in bitsets, and the held keys in a list in the order they
+// were pressed, so sending the per frame key events only costs as much as the keys actually held.
+
+class UnixKeyState
+{
+public:
+    UnixKeyState()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        for (int i = 0; i < wordCount_; ++i)
+        {
+            pressed_[i]  = 0;
+            released_[i] = 0;
+        }
+        heldCount_ = 0;
+    }
+
+    // returns true if the key went down, false if it was already held
+
+    bool press(Key key)
+    {
+        clear(released_, key);
+
+        if (test(pressed_, key))
+            return false;
+
+        set(pressed_, key);
+        held_[heldCount_++] = key;
+        return true;
+    }
+
+    // returns true if the key was held.
+    // note: the key stays held until the next send, so a tap between two frames is still seen as pressed
+
+    bool release(Key key)
+    {
+        if (!test(pressed_, key) || test(released_, key))
+            return false;
+
+        set(released_, key);
+        return true;
+    }
+
+    // release every held key, for a window losing focus that won't see their key releases.
+    // puts the keys that were held in keys, which has room for one of each key, and returns how many there were.
+
+    int releaseAll(Key keys[])
+    {
+        int count = 0;
+
+        for (int i = 0; i < heldCount_; ++i)
+        {
+            if (release(held_[i]))
+                keys[count++] = held_[i];
+        }
+
+        return count;
+    }
+
+    // send key up events for released keys and key pressed events for keys still held
+
+    void send(Listener* listener, DisplayInterface& display)
+    {
+        int count = 0;
+
+        for (int i = 0; i < heldCount_; ++i)
+        {
+            const Key key = held_[i];
+
+            if (test(released_, key))
+            {
+                if (listener)
+                    listener->onKeyUp(display, key);
+                clear(pressed_, key);
+                clear(released_, key);
+            }
+            else
+            {
+                if (listener)
+                    listener->onKeyPressed(display, key);
+                held_[count++] = key;
+            }
+        }
+
+        heldCount_ = count;
+    }
+
+private:
+    enum
+    {
+        keyCount_  = 256,
+        wordCount_ = keyCount_ / 32
+    };
+
+    static bool test(const integer32 bits[], Key key)
+    {
+        return (bits[key >> 5] >> (key & 31)) & 1;
+    }
+
+    static void set(integer32 bits[], Key key)
+    {
+        bits[key >> 5] |= 1u << (key & 31);
+    }
+
+    static void clear(integer32 bits[], Key key)
+    {
+        bits[key >> 5] &= ~(1u << (key & 31));
+    }
+
+    integer32 pressed_[wordCount_];
+    integer32 released_[wordCount_];
+    Key       held_[keyCount_];
+    int       heldCount_;
+};
+
+class UnixDisplay;
+
+// the x server connection shared by all unix displays in the process.
+//
+// the first display to open connects to the server and interns all the atoms we need
+// in a single round trip, the last display to close disconnects again. events for every
+// window arrive on this one connection, so each display registers its window in an xlib
+// context and dispatch routes each event to the display that owns the window.
+//
+// note: dispatching from one display's update may call the listeners of other displays.
+// like the rest of the library this is not thread safe, keep all displays on one thread.
+
+class UnixConnection
+{
+public:
+    enum AtomName
+    {
+        WMProtocols,
+        WMDeleteWindow,
+        NetWMState,
+        NetWMStateFullscreen,
+        NetWMBypassCompositor,
+        AtomCount
+    };
+
+    // true if the server looks like it is on another machine, so frames are best sent in tiles.
+    // that is when we reach it over tcp, or when it can't share memory with its clients.
+    // note: ssh forwards the display as localhost:10.0, a tcp connection to the ssh daemon
+
+    static bool remote()
+    {
+        return remote_;
+    }
+
+    static ::Display* acquire()
+    {
+        if (references_ == 0)
+        {
+            display_ = ::XOpenDisplay(0);
+            if (!display_)
+                return nullptr;
+
+            static const char* names[AtomCount] = {
+                "WM_PROTOCOLS",
+                "WM_DELETE_WINDOW",
+                "_NET_WM_STATE",
+                "_NET_WM_STATE_FULLSCREEN",
+                "_NET_WM_BYPASS_COMPOSITOR",
+            };
+
+            // note: create the atoms that don't exist yet, without a window manager nobody else will have
+
+            if (!::XInternAtoms(display_, const_cast<char**>(names), AtomCount, False, atoms_))
+            {
+                ::XCloseDisplay(display_);
+                display_ = nullptr;
+                return nullptr;
+            }
+
+            context_ = XUniqueContext();
+
+            int opcode, event, error;
+            remote_ = remoteName(DisplayString(display_)) || !::XQueryExtension(display_, "MIT-SHM", &opcode, &event, &error);
+        }
+
+        references_++;
+        return display_;
+    }
+
+    static void release()
+    {
+        if (references_ == 0)
+            return;
+
+        if (--references_ == 0)
+        {
+            ::XCloseDisplay(display_);
+            display_ = nullptr;
+        }
+    }
+
+    static Atom atom(AtomName name)
+    {
+        return atoms_[name];
+    }
+
+    static void attach(::Window window, UnixDisplay* owner)
+    {
+        ::XSaveContext(display_, window, context_, reinterpret_cast<XPointer>(owner));
+    }
+
+    static void detach(::Window window)
+    {
+        ::XDeleteContext(display_, window, context_);
+    }
+
+    static void dispatch();
+
+private:
+    // a display name is [protocol/][host]:display[.screen], without a host or with unix as the host
+    // it is a local socket. names that start with a slash are local socket paths.
+
+    static bool remoteName(const char* name)
+    {
+        if (!name || name[0] == '/')
+            return false;
+
+        const char* protocol = strchr(name, '/');
+        const char* host     = protocol ? protocol + 1 : name;
+        const char* colon    = strrchr(host, ':');
+        if (!colon || colon == host)
+            return false;
+
+        return !(colon - host == 4 && strncmp(host, "unix", 4) == 0);
+    }
+
+    static ::Display* display_;
+    static int        references_;
+    static XContext   context_;
+    static Atom       atoms_[AtomCount];
+    static bool       remote_;
 };
 
-UnixDisplay::TKeyMap   UnixDisplay::normalKeys_;
-UnixDisplay::TKeyMap   UnixDisplay::functionKeys_;
-UnixDisplay::TKeyFlags UnixDisplay::keyIsPressed_;
-UnixDisplay::TKeyFlags UnixDisplay::keyIsReleased_;
-bool                   UnixDisplay::keyMapsInitialized_ = UnixDisplay::initializeKeyMaps();
+#ifdef PIXELTOASTER_USE_PRESENT
+
+// presents frames through the x present extension.
+//
+// each frame is drawn into one of two back pixmaps which is then queued with PresentPixmap.
+// the server tells us when a frame reached the screen (CompleteNotify) and when a pixmap
+// is no longer in use and may be drawn into again (IdleNotify). in vsync mode each frame
+// targets the vertical blank after the previous one, and we wait for the previous frame
+// to complete before drawing the next, which paces updates to the refresh rate.
+
+class UnixPresenter
+{
+public:
+    UnixPresenter()
+    {
+        defaults();
+    }
+
+    bool open(::Display* display, ::Window window, int width, int height, int depth)
+    {
+        connection_ = ::XGetXCBConnection(display);
+
+        const xcb_query_extension_reply_t* extension = ::xcb_get_extension_data(connection_, &xcb_present_id);
+        if (!extension || !extension->present)
+        {
+            defaults();
+            return false;
+        }
+
+        xcb_present_query_version_reply_t* version = ::xcb_present_query_version_reply(connection_, ::xcb_present_query_version(connection_, 1, 0), nullptr);
+        if (!version)
+        {
+            defaults();
+            return false;
+        }
+        free(version);
+
+        display_ = display;
+        window_  = window;
+
+        for (int i = 0; i < pixmapCount_; ++i)
+            pixmaps_[i] = ::XCreatePixmap(display_, window_, width, height, depth);
+
+        // note: present events go to their own queue so they never get mixed up with xlib's events
+
+        eventId_ = ::xcb_generate_id(connection_);
+        ::xcb_present_select_input(connection_, eventId_, window_, XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY | XCB_PRESENT_EVENT_MASK_IDLE_NOTIFY);
+        events_ = ::xcb_register_for_special_xge(connection_, &xcb_present_id, eventId_, nullptr);
+        if (!events_)
+        {
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void close()
+    {
+        if (events_)
+            ::xcb_unregister_for_special_event(connection_, events_);
+
+        for (int i = 0; i < pixmapCount_; ++i)
+        {
+            if (pixmaps_[i])
+                ::XFreePixmap(display_, pixmaps_[i]);
+        }
+
+        defaults();
+    }
+
+    bool open() const
+    {
+        return events_ != nullptr;
+    }
+
+    // get the pixmap to draw the next frame into
+
+    ::Pixmap begin(Presentation presentation)
+    {
+        if (presentation == Presentation::VSync)
+        {
+            while (pending_ && waitEvent())
+                ;
+        }
+
+        current_ = (current_ + 1) % pixmapCount_;
+
+        while (busy_[current_] && waitEvent())
+            ;
+
+        return pixmaps_[current_];
+    }
+
+    // queue the pixmap returned by begin for presentation at x, y in the window
+
+    void present(Presentation presentation, int x, int y)
+    {
+        const uint32_t  options   = presentation == Presentation::Immediate ? XCB_PRESENT_OPTION_ASYNC : XCB_PRESENT_OPTION_NONE;
+        const integer64 targetMsc = presentation == Presentation::VSync && timingValid_ ? timing_.msc + 1 : 0;
+
+        serial_++;
+        busy_[current_] = true;
+        pending_        = true;
+
+        ::xcb_present_pixmap(connection_, window_, pixmaps_[current_], serial_, 0, 0, x, y, 0, 0, 0,
+                             options, targetMsc, 0, 0, 0, nullptr);
+        ::xcb_flush(connection_);
+    }
+
+    void pumpEvents()
+    {
+        while (xcb_generic_event_t* event = ::xcb_poll_for_special_event(connection_, events_))
+        {
+            handleEvent(event);
+            free(event);
+        }
+    }
+
+    bool timing(Timing& timing) const
+    {
+        if (!timingValid_)
+            return false;
+
+        timing = timing_;
+        return true;
+    }
+
+private:
+    enum
+    {
+        pixmapCount_ = 2
+    };
+
+    void defaults()
+    {
+        connection_ = nullptr;
+        display_    = nullptr;
+        window_     = 0;
+        events_     = nullptr;
+        eventId_    = 0;
+        current_    = 0;
+        serial_     = 0;
+        pending_    = false;
+
+        for (int i = 0; i < pixmapCount_; ++i)
+        {
+            pixmaps_[i] = 0;
+            busy_[i]    = false;
+        }
+
+        timing_.time   = 0.0;
+        timing_.msc    = 0;
+        timing_.serial = 0;
+        timingValid_   = false;
+    }
+
+    bool waitEvent()
+    {
+        xcb_generic_event_t* event = ::xcb_wait_for_special_event(connection_, events_);
+        if (!event)
+        {
+            // connection is gone, nothing is ever going to complete
+
+            pending_ = false;
+            for (int i = 0; i < pixmapCount_; ++i)
+                busy_[i] = false;
+            return false;
+        }
+
+        handleEvent(event);
+        free(event);
+        return true;
+    }
+
+    void handleEvent(const xcb_generic_event_t* event)
+    {
+        const xcb_present_generic_event_t* presentEvent = reinterpret_cast<const xcb_present_generic_event_t*>(event);
+
+        switch (presentEvent->evtype)
+        {
+            case XCB_PRESENT_EVENT_COMPLETE_NOTIFY:
+            {
+                const xcb_present_complete_notify_event_t* complete = reinterpret_cast<const xcb_present_complete_notify_event_t*>(event);
+                if (complete->kind != XCB_PRESENT_COMPLETE_KIND_PIXMAP)
+                    break;
+
+                timing_.time   = complete->ust * 1e-6;
+                timing_.msc    = complete->msc;
+                timing_.serial = complete->serial;
+                timingValid_   = true;
+
+                if (complete->serial == serial_)
+                    pending_ = false;
+                break;
+            }
+
+            case XCB_PRESENT_EVENT_IDLE_NOTIFY:
+            {
+                const xcb_present_idle_notify_event_t* idle = reinterpret_cast<const xcb_present_idle_notify_event_t*>(event);
+                for (int i = 0; i < pixmapCount_; ++i)
+                {
+                    if (pixmaps_[i] == idle->pixmap)
+                        busy_[i] = false;
+                }
+                break;
+            }
+        }
+    }
+
+    xcb_connection_t*    connection_;
+    ::Display*           display_;
+    ::Window             window_;
+    xcb_special_event_t* events_;
+    uint32_t             eventId_;
+    ::Pixmap             pixmaps_[pixmapCount_];
+    bool                 busy_[pixmapCount_];
+    int                  current_;
+    integer32            serial_;
+    bool                 pending_;
+    Timing               timing_;
+    bool                 timingValid_;
+};
+
+#endif
+
+#ifdef PIXELTOASTER_USE_RANDR
+
+// switches the monitor of a fullscreen display to the smallest video mode the frame fits in,
+// and back to the mode it had when the display closes, like the windows fullscreen device does.
+//
+// the monitor is the crtc of the primary output, or the first crtc that is on if there is no
+// primary output. the screen keeps its size, the crtc just shows a smaller part of it.
+
+class UnixModeSwitch
+{
+public:
+    UnixModeSwitch()
+    {
+        defaults();
+    }
+
+    // find the monitor and switch it to a mode of at least width x height if it has one.
+    // returns false if there is no monitor we can use, the screen then stays as it is.
+
+    bool enter(::Display* display, int width, int height)
+    {
+        leave();
+
+        connection_ = ::XGetXCBConnection(display);
+
+        const xcb_query_extension_reply_t* extension = ::xcb_get_extension_data(connection_, &xcb_randr_id);
+        if (!extension || !extension->present)
+        {
+            defaults();
+            return false;
+        }
+
+        // note: current screen resources and primary outputs need version 1.3
+
+        xcb_randr_query_version_reply_t* version = ::xcb_randr_query_version_reply(connection_, ::xcb_randr_query_version(connection_, 1, 3), nullptr);
+        if (!version || (version->major_version == 1 && version->minor_version < 3))
+        {
+            free(version);
+            defaults();
+            return false;
+        }
+        free(version);
+
+        const xcb_window_t root = DefaultRootWindow(display);
+
+        xcb_randr_get_screen_resources_current_reply_t* resources = ::xcb_randr_get_screen_resources_current_reply(connection_, ::xcb_randr_get_screen_resources_current(connection_, root), nullptr);
+        if (!resources)
+        {
+            defaults();
+            return false;
+        }
+
+        const bool result = enter(root, resources, width, height);
+
+        free(resources);
+
+        if (!result)
+            defaults();
+
+        return result;
+    }
+
+    // put the monitor back in the mode it had before enter
+
+    void leave()
+    {
+        if (crtc_)
+        {
+            xcb_randr_set_crtc_config_reply_t* reply = ::xcb_randr_set_crtc_config_reply(connection_, ::xcb_randr_set_crtc_config(connection_, crtc_, XCB_CURRENT_TIME, XCB_CURRENT_TIME, x_, y_, mode_, rotation_, outputCount_, outputs_), nullptr);
+            free(reply);
+        }
+
+        defaults();
+    }
+
+    // where the monitor is on the screen and how big it is, valid after enter succeeded
+
+    void monitor(int& left, int& top, int& width, int& height) const
+    {
+        left   = x_;
+        top    = y_;
+        width  = width_;
+        height = height_;
+    }
+
+private:
+    enum
+    {
+        maximumOutputs_ = 8
+    };
+
+    void defaults()
+    {
+        connection_  = nullptr;
+        crtc_        = 0;
+        mode_        = 0;
+        rotation_    = 0;
+        outputCount_ = 0;
+        x_           = 0;
+        y_           = 0;
+        width_       = 0;
+        height_      = 0;
+    }
+
+    bool enter(xcb_window_t root, const xcb_randr_get_screen_resources_current_reply_t* resources, int width, int height)
+    {
+        xcb_randr_crtc_t crtc = 0;
+
+        xcb_randr_get_output_primary_reply_t* primary = ::xcb_randr_get_output_primary_reply(connection_, ::xcb_randr_get_output_primary(connection_, root), nullptr);
+        if (primary)
+        {
+            xcb_randr_get_output_info_reply_t* output = ::xcb_randr_get_output_info_reply(connection_, ::xcb_randr_get_output_info(connection_, primary->output, resources->config_timestamp), nullptr);
+            if (output)
+                crtc = output->crtc;
+            free(output);
+            free(primary);
+        }
+
+        const xcb_randr_crtc_t* crtcs = ::xcb_randr_get_screen_resources_current_crtcs(resources);
+        for (int i = 0; !crtc && i < resources->num_crtcs; ++i)
+        {
+            xcb_randr_get_crtc_info_reply_t* info = ::xcb_randr_get_crtc_info_reply(connection_, ::xcb_randr_get_crtc_info(connection_, crtcs[i], resources->config_timestamp), nullptr);
+            if (info && info->mode)
+                crtc = crtcs[i];
+            free(info);
+        }
+
+        if (!crtc)
+            return false;
+
+        xcb_randr_get_crtc_info_reply_t* info = ::xcb_randr_get_crtc_info_reply(connection_, ::xcb_randr_get_crtc_info(connection_, crtc, resources->config_timestamp), nullptr);
+        if (!info || !info->mode || info->num_outputs == 0 || info->num_outputs > maximumOutputs_)
+        {
+            free(info);
+            return false;
+        }
+
+        x_           = info->x;
+        y_           = info->y;
+        width_       = info->width;
+        height_      = info->height;
+        mode_        = info->mode;
+        rotation_    = info->rotation;
+        outputCount_ = info->num_outputs;
+        memcpy(outputs_, ::xcb_randr_get_crtc_info_outputs(info), outputCount_ * sizeof(xcb_randr_output_t));
+
+        const xcb_timestamp_t timestamp = info->timestamp;
+
+        free(info);
+
+        // pick the smallest mode of the monitor's first output that fits the frame.
+        // note: a monitor turned on its side shows modes the other way around
+
+        const bool sideways = (rotation_ & (XCB_RANDR_ROTATION_ROTATE_90 | XCB_RANDR_ROTATION_ROTATE_270)) != 0;
+
+        xcb_randr_get_output_info_reply_t* output = ::xcb_randr_get_output_info_reply(connection_, ::xcb_randr_get_output_info(connection_, outputs_[0], resources->config_timestamp), nullptr);
+        if (!output)
+            return true;
+
+        const xcb_randr_mode_t*      outputModes = ::xcb_randr_get_output_info_modes(output);
+        const xcb_randr_mode_info_t* modes       = ::xcb_randr_get_screen_resources_current_modes(resources);
+
+        xcb_randr_mode_t best       = 0;
+        int              bestWidth  = 0;
+        int              bestHeight = 0;
+
+        for (int i = 0; i < output->num_modes; ++i)
+        {
+            for (int j = 0; j < resources->num_modes; ++j)
+            {
+                if (modes[j].id != outputModes[i])
+                    continue;
+
+                const int w = sideways ? modes[j].height : modes[j].width;
+                const int h = sideways ? modes[j].width : modes[j].height;
+                if (w >= width && h >= height && (!best || w * h < bestWidth * bestHeight))
+                {
+                    best       = modes[j].id;
+                    bestWidth  = w;
+                    bestHeight = h;
+                }
+            }
+        }
+
+        free(output);
+
+        if (!best || best == mode_)
+            return true;
+
+        xcb_randr_set_crtc_config_reply_t* reply = ::xcb_randr_set_crtc_config_reply(connection_, ::xcb_randr_set_crtc_config(connection_, crtc, timestamp, resources->config_timestamp, x_, y_, best, rotation_, outputCount_, outputs_), nullptr);
+        const bool switched = reply && reply->status == XCB_RANDR_SET_CONFIG_SUCCESS;
+        free(reply);
+
+        if (switched)
+        {
+            crtc_   = crtc;
+            width_  = bestWidth;
+            height_ = bestHeight;
+        }
+
+        return true;
+    }
+
+    xcb_connection_t*  connection_;
+    xcb_randr_crtc_t   crtc_; // crtc to put back in its mode, 0 if we didn't switch
+    xcb_randr_mode_t   mode_;
+    uint16_t           rotation_;
+    xcb_randr_output_t outputs_[maximumOutputs_];
+    int                outputCount_;
+    int                x_;
+    int                y_;
+    int                width_;
+    int                height_;
+};
+
+#endif
+
+// helper threads that share work with the thread that updates a display group.
+//
+// the threads are started the first time there is work for them and then wait for the
+// next batch, so a group update costs waking them rather than creating them each frame.
+// each batch runs the work on as many helpers as asked for plus the calling thread, the
+// work takes its share by itself and run returns once everybody has finished.
+//
+// note: like the rest of the library this is not thread safe, run batches from one thread.
+
+class UnixWorkerPool
+{
+public:
+    typedef void* (*Work)(void* data);
+
+    UnixWorkerPool()
+    {
+        ::pthread_mutex_init(&mutex_, nullptr);
+        ::pthread_cond_init(&start_, nullptr);
+        ::pthread_cond_init(&done_, nullptr);
+        started_ = false;
+        stop_    = false;
+        count_   = 0;
+        work_    = nullptr;
+        data_    = nullptr;
+        batch_   = 0;
+        active_  = 0;
+        busy_    = 0;
+    }
+
+    ~UnixWorkerPool()
+    {
+        ::pthread_mutex_lock(&mutex_);
+        stop_ = true;
+        ::pthread_cond_broadcast(&start_);
+        ::pthread_mutex_unlock(&mutex_);
+
+        for (int i = 0; i < count_; ++i)
+            ::pthread_join(threads_[i].thread, nullptr);
+
+        ::pthread_cond_destroy(&done_);
+        ::pthread_cond_destroy(&start_);
+        ::pthread_mutex_destroy(&mutex_);
+    }
+
+    // run the work on up to helpers helper threads and the calling thread, returns when all are done
+
+    void run(Work work, void* data, int helpers)
+    {
+        if (!started_)
+            start();
+
+        if (helpers > count_)
+            helpers = count_;
+
+        if (helpers > 0)
+        {
+            ::pthread_mutex_lock(&mutex_);
+            work_   = work;
+            data_   = data;
+            active_ = helpers;
+            busy_   = helpers;
+            batch_++;
+            ::pthread_cond_broadcast(&start_);
+            ::pthread_mutex_unlock(&mutex_);
+        }
+
+        work(data);
+
+        if (helpers > 0)
+        {
+            ::pthread_mutex_lock(&mutex_);
+            while (busy_ > 0)
+                ::pthread_cond_wait(&done_, &mutex_);
+            ::pthread_mutex_unlock(&mutex_);
+        }
+    }
+
+private:
+    enum
+    {
+        maximumThreads_ = 15
+    };
+
+    struct Thread
+    {
+        UnixWorkerPool* pool;
+        int             index;
+        pthread_t       thread;
+    };
+
+    // note: sized once, one thread per processor besides the calling thread
+
+    void start()
+    {
+        started_ = true;
+
+        int wanted = static_cast<int>(::sysconf(_SC_NPROCESSORS_ONLN)) - 1;
+        if (wanted > maximumThreads_)
+            wanted = maximumThreads_;
+
+        while (count_ < wanted)
+        {
+            threads_[count_].pool  = this;
+            threads_[count_].index = count_;
+
+            if (::pthread_create(&threads_[count_].thread, nullptr, loop, &threads_[count_]) != 0)
+                break;
+
+            count_++;
+        }
+    }
+
+    static void* loop(void* data)
+    {
+        const Thread&   self = *static_cast<const Thread*>(data);
+        UnixWorkerPool& pool = *self.pool;
+
+        integer32 seen = 0;
+
+        ::pthread_mutex_lock(&pool.mutex_);
+
+        while (true)
+        {
+            while (!pool.stop_ && pool.batch_ == seen)
+                ::pthread_cond_wait(&pool.start_, &pool.mutex_);
+
+            if (pool.stop_)
+                break;
+
+            seen = pool.batch_;
+
+            // note: helpers beyond those asked for sit this batch out
+
+            if (self.index >= pool.active_)
+                continue;
+
+            const Work work = pool.work_;
+            void*      data = pool.data_;
+
+            ::pthread_mutex_unlock(&pool.mutex_);
+            work(data);
+            ::pthread_mutex_lock(&pool.mutex_);
+
+            if (--pool.busy_ == 0)
+                ::pthread_cond_signal(&pool.done_);
+        }
+
+        ::pthread_mutex_unlock(&pool.mutex_);
+        return nullptr;
+    }
+
+    pthread_mutex_t mutex_;
+    pthread_cond_t  start_; // a new batch or stop
+    pthread_cond_t  done_;  // the last helper of a batch finished
+    bool            started_;
+    bool            stop_;
+    Thread          threads_[maximumThreads_];
+    int             count_; // threads running
+    Work            work_;
+    void*           data_;
+    integer32       batch_;  // number of the current batch, helpers wait for the next one
+    int             active_; // helpers taking part in the current batch
+    int             busy_;   // helpers still working on it
+};
+
+class UnixDisplay : public DisplayAdapter
+{
+public:
+    UnixDisplay()
+    {
+        defaults();
+    }
+
+    ~UnixDisplay()
+    {
+        close();
+    }
+
+    bool open(const char title[], int width, int height, Output output, Mode mode) override
+    {
+        // an open display that just changes size or title keeps its connection, window and buffers
+
+        if (DisplayAdapter::open() && window_ && mode == DisplayAdapter::mode() && translucent() == translucent_ &&
+            (output == Output::Fullscreen) == (DisplayAdapter::output() == Output::Fullscreen))
+            return reopen(title, width, height);
+
+        DisplayAdapter::open(title, width, height, output, mode);
+
+        // let's open a display
+
+        display_ = UnixConnection::acquire();
+        if (!display_)
+        {
+            close();
+            return false;
+        }
+
+        const int screen = DefaultScreen(display_);
+        ::Visual* visual = DefaultVisual(display_, screen);
+        if (!visual)
+        {
+            close();
+            return false;
+        }
+
+        // translucent windows need a visual with alpha, which compositing servers offer at depth 32.
+        // optional: without one the window stays opaque
+
+        ::XVisualInfo alphaVisual;
+        translucent_ = translucent();
+        const bool translucent = translucent_ && ::XMatchVisualInfo(display_, screen, 32, TrueColor, &alphaVisual) &&
+                                 findFormat(32, alphaVisual.red_mask, alphaVisual.green_mask, alphaVisual.blue_mask) == Format::XRGB8888;
+        if (translucent)
+            visual = alphaVisual.visual;
+
+        // It gets messy when talking about color depths.
+        //
+        // The depth of a visual doesn't say how many bits each pixel takes in an image,
+        // the server's pixmap formats do. displayDepth 15 & 16 take 16 bitsPerPixel, and
+        // displayDepth 24 usually takes 32 but some servers (often vnc backed ones) pack
+        // it into exactly 24, which saves a quarter of the bytes we send them.
+        //
+        // Deep color visuals have displayDepth 30 and also take 32 bitsPerPixel, so
+        // formats are matched by bitsPerPixel and the masks rather than by depth.
+        //
+        const int displayDepth = translucent ? 32 : DefaultDepth(display_, screen);
+        int       bitsPerPixel = 0;
+        int       formatCount  = 0;
+        if (::XPixmapFormatValues* formats = ::XListPixmapFormats(display_, &formatCount))
+        {
+            for (int i = 0; i < formatCount; ++i)
+            {
+                if (formats[i].depth == displayDepth)
+                    bitsPerPixel = formats[i].bits_per_pixel;
+            }
+            XFree(formats);
+        }
+        if (bitsPerPixel != 16 && bitsPerPixel != 24 && bitsPerPixel != 32)
+        {
+            close();
+            return false;
+        }
+        const int bytesPerPixel = bitsPerPixel / 8;
+
+        destFormat_             = translucent ? Format(Format::ARGB8888) : findFormat(bitsPerPixel,
+                                 visual->red_mask, visual->green_mask, visual->blue_mask);
+
+        // the masks describe pixel values, most significant byte first, while packed 24 bit pixels are
+        // bytes in the server's byte order. least significant byte first servers store red and blue swapped.
+
+        if (bytesPerPixel == 3 && ImageByteOrder(display_) == LSBFirst)
+        {
+            if (destFormat_ == Format::RGB888)
+                destFormat_ = Format::BGR888;
+            else if (destFormat_ == Format::BGR888)
+                destFormat_ = Format::RGB888;
+        }
+
+        floatingPointConverter_ = requestConverter(Format::XBGRFFFF, destFormat_);
+        trueColorConverter_     = requestConverter(Format::XRGB8888, destFormat_);
+        if (!floatingPointConverter_ || !trueColorConverter_)
+        {
+            close();
+            return false;
+        }
+
+        // servers with the other byte order get pixels swapped by our converters, rather than by xlib a pixel at a time
+
+#if defined(PIXELTOASTER_LITTLE_ENDIAN)
+        swapBytes_ = ImageByteOrder(display_) != LSBFirst;
+#else
+        swapBytes_ = ImageByteOrder(display_) != MSBFirst;
+#endif
+
+        // note: packed 24 bit pixels are already written a byte at a time in the server's order
+
+        if (bytesPerPixel == 3)
+            swapBytes_ = false;
+
+        // let's create a window.
+        //
+        // fullscreen output covers a whole monitor and shows the frame in the middle of it,
+        // scaled up by the largest whole factor that fits. default output is windowed.
+
+        if (output == Output::Fullscreen)
+            DisplayAdapter::fullscreen();
+        else
+            DisplayAdapter::windowed();
+
+        const bool fullscreen = DisplayAdapter::output() == Output::Fullscreen;
+
+        const Window root = DefaultRootWindow(display_);
+
+        int left, top, windowWidth, windowHeight;
+        placeWindow(left, top, windowWidth, windowHeight);
+
+        ::XSetWindowAttributes attributes;
+        attributes.border_pixel = attributes.background_pixel = BlackPixel(display_, screen);
+        attributes.backing_store                              = NotUseful;
+
+        unsigned long attributeMask = CWBackPixel | CWBorderPixel | CWBackingStore;
+
+        if (translucent)
+        {
+            // note: a visual other than the root window's needs a colormap of its own, and zero is transparent on it
+
+            colormap_           = ::XCreateColormap(display_, root, visual, AllocNone);
+            attributes.colormap = colormap_;
+            attributes.border_pixel = attributes.background_pixel = 0;
+            attributeMask |= CWColormap;
+        }
+
+        window_ = ::XCreateWindow(display_, root, left, top, windowWidth, windowHeight, 0,
+                                  displayDepth, InputOutput, visual, attributeMask, &attributes);
+
+        UnixConnection::attach(window_, this);
+
+        ::XStoreName(display_, window_, title);
+
+        Atom wmDeleteWindow = UnixConnection::atom(UnixConnection::WMDeleteWindow);
+        if (::XSetWMProtocols(display_, window_, &wmDeleteWindow, 1) == 0)
+        {
+            close();
+            return false;
+        }
+
+        setSizeHints(left, top);
+
+        if (fullscreen)
+        {
+            // ask the window manager to drop the decorations and keep us above everything else,
+            // and the compositor to leave the window alone so it can show it without compositing.
+            // note: set before the window is mapped, so the window manager sees it from the start
+
+            Atom state = UnixConnection::atom(UnixConnection::NetWMStateFullscreen);
+            ::XChangeProperty(display_, window_, UnixConnection::atom(UnixConnection::NetWMState), XA_ATOM, 32,
+                              PropModeReplace, reinterpret_cast<unsigned char*>(&state), 1);
+
+            // note: translucent windows only show the desktop behind them when they are composited
+
+            if (!translucent)
+            {
+                long bypassCompositor = 1;
+                ::XChangeProperty(display_, window_, UnixConnection::atom(UnixConnection::NetWMBypassCompositor), XA_CARDINAL, 32,
+                                  PropModeReplace, reinterpret_cast<unsigned char*>(&bypassCompositor), 1);
+            }
+
+            // hide the mouse cursor like the windows display does
+
+            static char blank[1] = {0};
+            ::Pixmap    pixmap   = ::XCreateBitmapFromData(display_, window_, blank, 1, 1);
+            ::XColor    black;
+            black.pixel = BlackPixel(display_, screen);
+            black.red = black.green = black.blue = 0;
+            black.flags                          = DoRed | DoGreen | DoBlue;
+            cursor_                              = ::XCreatePixmapCursor(display_, pixmap, pixmap, &black, &black, 0, 0);
+            ::XFreePixmap(display_, pixmap);
+            ::XDefineCursor(display_, window_, cursor_);
+        }
+
+        ::XClearWindow(display_, window_);
+        ::XSelectInput(display_, window_, eventMask_);
+
+        // create (image) buffer
+
+        bytesPerPixel_ = bytesPerPixel;
+        depth_         = displayDepth;
+        loadPalette(0, 256);
+        if (!buffer_.reserve(width * height * bytesPerPixel))
+        {
+            close();
+            return false;
+        }
+
+        // note: the default gc is only good for windows of the default depth
+
+        gc_ = ::XCreateGC(display_, window_, 0, nullptr);
+
+        if (!layout(windowWidth, windowHeight))
+        {
+            close();
+            return false;
+        }
+
+        // we have a winner!
+
+        ::XMapRaised(display_, window_);
+        ::XFlush(display_);
+
+        if (DisplayAdapter::listener())
+            DisplayAdapter::listener()->onOpen(wrapper() ? *wrapper() : *(DisplayInterface*)this);
+
+        return true;
+    }
+
+    // change the title and size of the open display.
+    // the window is resized in place and the buffers only grow, so going back and forth between sizes costs nothing.
+
+    bool reopen(const char title[], int width, int height)
+    {
+        forgetConversion();
+
+        DisplayAdapter::resize(width, height);
+        this->title(title);
+        isShuttingDown_ = false;
+
+        if (!buffer_.reserve(width * height * bytesPerPixel_))
+        {
+            close();
+            return false;
+        }
+
+        int left, top, windowWidth, windowHeight;
+        placeWindow(left, top, windowWidth, windowHeight);
+
+        setSizeHints(left, top);
+
+        if (output() == Output::Fullscreen)
+            ::XMoveResizeWindow(display_, window_, left, top, windowWidth, windowHeight);
+        else
+            ::XResizeWindow(display_, window_, windowWidth, windowHeight);
+
+        if (!layout(windowWidth, windowHeight))
+        {
+            close();
+            return false;
+        }
+
+        ::XClearWindow(display_, window_);
+        ::XFlush(display_);
+
+        if (DisplayAdapter::listener())
+            DisplayAdapter::listener()->onOpen(wrapper() ? *wrapper() : *(DisplayInterface*)this);
+
+        return true;
+    }
+
+    void close() override
+    {
+#ifdef PIXELTOASTER_USE_PRESENT
+        presenter_.close();
+#endif
+
+        forgetConversion();
+
+        if (image_)
+        {
+            XDestroyImage(image_);
+            image_ = 0;
+        }
+
+        if (display_ && gc_)
+        {
+            ::XFreeGC(display_, gc_);
+            gc_ = 0;
+        }
+
+        if (display_ && window_)
+        {
+            UnixConnection::detach(window_);
+            XDestroyWindow(display_, window_);
+            window_ = 0;
+        }
+
+        if (display_ && colormap_)
+        {
+            ::XFreeColormap(display_, colormap_);
+            colormap_ = 0;
+        }
+
+        if (display_ && cursor_)
+        {
+            ::XFreeCursor(display_, cursor_);
+            cursor_ = 0;
+        }
+
+#ifdef PIXELTOASTER_USE_RANDR
+        modeSwitch_.leave();
+#endif
+
+        if (display_)
+        {
+            UnixConnection::release();
+            display_ = 0;
+        }
+
+        DisplayAdapter::close(); // note: this calls our virtual defaults method
+    }
+
+    bool update(const TrueColorPixel* trueColorPixels, const FloatingPointPixel* floatingPointPixels, const Rectangle* dirtyBox) override
+    {
+        if (trueColorPixels)
+            return update(trueColorPixels, Format::XRGB8888, dirtyBox);
+        else
+            return update(floatingPointPixels, Format::XBGRFFFF, dirtyBox);
+    }
+
+    bool update(const void* pixels, Format format, const Rectangle* dirtyBox) override
+    {
+        const void* planes[3];
+        int         pitches[3];
+        if (pixels && videoPlanes(format, pixels, width(), height(), planes, pitches))
+            return update(planes, pitches, format, ColorSpace::BT601, dirtyBox);
+
+        return update(pixels, format, width() * pixelSize(format), 0, 0, dirtyBox);
+    }
+
+    // note: video is converted straight into our buffer, one band at a time just like other formats
+
+    bool update(const void* const planes[], const int pitches[], Format format, ColorSpace colorSpace, const Rectangle* dirtyBox) override
+    {
+        if (isShuttingDown_)
+        {
+            close();
+            return false;
+        }
+
+        if (!display_ || !window_ || !image_ || !planes || !pitches || !videoConverter_.select(format, colorSpace, destFormat_))
+            return false;
+
+        const int w       = width();
+        const int h       = height();
+        const int rowSize = w * bytesPerPixel_;
+
+        // our buffer is about to hold a frame nobody else can share
+
+        forgetConversion();
+
+        if (remote())
+        {
+            if (!withinBandwidth())
+            {
+                pumpEvents();
+                return true;
+            }
+
+            convertVideo(planes, pitches, 0, h);
+
+            if (!sendTiles(buffer_.get(), rowSize))
+                return false;
+
+            pumpEvents();
+            return true;
+        }
+
+        sentValid_ = false;
+
+        const ::Drawable target = beginPresent();
+
+        const int band = bandHeight() > 0 && bandHeight() < h ? bandHeight() : h;
+
+        for (int row = 0; row < h; row += band)
+        {
+            const int rows = row + band < h ? band : h - row;
+
+            convertVideo(planes, pitches, row, rows);
+
+            put(target, buffer_.get(), rowSize, 0, row, w, rows);
+            ::XFlush(display_);
+        }
+
+        endPresent();
+
+        ownFrame_ = true;
+
+        pumpEvents();
+
+        return true;
+    }
+
+    // note: the viewport is read in place, by the converters or by the server if it is in our format already
+
+    bool update(const void* canvas, Format format, int pitch, int x, int y, const Rectangle* dirtyBox) override
+    {
+        if (!canvas || !viewportFits(pixelSize(format), pitch, x, y) || !beginUpdate(canvas, format))
+            return false;
+
+        const int w = width();
+        const int h = height();
+
+        const char* pixels = static_cast<const char*>(canvas) + y * pitch + x * pixelSize(format);
+
+        if (remote())
+            return updateTiles(pixels, format, pitch);
+
+        sentValid_ = false;
+
+        // the drawable we put the image in: either the window itself, or a
+        // back pixmap that is queued for presentation once it is complete
+
+        const ::Drawable target = beginPresent();
+
+        int         convertedPitch = 0;
+        const char* converted      = findConversion(pixels, format, pitch, convertedPitch);
+
+        if (!converted)
+        {
+            // extra conversion step: copy pixels to buffer.
+            //
+            // the frame is converted in horizontal bands and each band is flushed to the
+            // server as soon as it is ready, so the server copies band n while we are busy
+            // converting band n + 1, instead of waiting for the whole frame to convert.
+
+            storeConversion(pixels, format, pitch);
+
+            const int band = bandHeight() > 0 && bandHeight() < h ? bandHeight() : h;
+
+            for (int row = 0; row < h; row += band)
+            {
+                const int rows = row + band < h ? band : h - row;
+
+                convert(pixels, format, pitch, 0, row, w, rows);
+
+                put(target, buffer_.get(), w * bytesPerPixel_, 0, row, w, rows);
+                ::XFlush(display_);
+            }
+        }
+        else
+        {
+            // shortcut: avoid extra copy, either the pixels are already in our format
+            // or another display converted the same pixels to our format this frame
+
+            put(target, converted, convertedPitch, 0, 0, w, h);
+            ::XFlush(display_);
+        }
+
+        endPresent();
+
+        pumpEvents();
+
+        return true;
+    }
+
+    // the server moves what stays in view with a copy inside the window, so only the strips
+    // scrolled into view are converted and sent. our copy of the frame moves along with it,
+    // so we can still repaint exposed parts of the window from it.
+
+    bool scroll(int dx, int dy, const void* pixels, Format format) override
+    {
+        if (!beginUpdate(pixels, format))
+            return false;
+
+        const int w          = width();
+        const int h          = height();
+        const int keptWidth  = w - (dx < 0 ? -dx : dx);
+        const int keptHeight = h - (dy < 0 ? -dy : dy);
+        const int pitch      = w * pixelSize(format);
+
+        if (remote())
+        {
+            // move the frame we sent along with the window, then only the tiles scrolled into view differ
+
+            if (keptWidth > 0 && keptHeight > 0 && sentValid_)
+            {
+                scrollWindow(dx, dy);
+                moveFrame(sent_.get(), w, h, bytesPerPixel_, dx, dy);
+            }
+
+            return updateTiles((const char*)pixels, format, pitch);
+        }
+
+        // note: the window has to show our last frame, which it does not while presenting through
+        // back pixmaps or when the frame was converted by another display and is not ours to move
+
+        const bool direct = format == destFormat_ && !swapBytes_;
+
+        if (keptWidth <= 0 || keptHeight <= 0 || presentation() != Presentation::Default || (!direct && !ownFrame_))
+            return update(pixels, format, pitch, 0, 0, nullptr);
+
+        sentValid_ = false;
+
+        scrollWindow(dx, dy);
+
+        if (direct)
+        {
+            // the window now shows the caller's pixels, which we don't keep, rather than a conversion of ours.
+            // like after a direct update, exposed parts stay blank until the next update
+
+            ownFrame_   = false;
+            generation_ = 0;
+        }
+        else
+        {
+            moveFrame(buffer_.get(), w, h, bytesPerPixel_, dx, dy);
+            storeConversion(pixels, format, pitch);
+        }
+
+        // the columns scrolled in beside the kept part, then the rows scrolled in above or below it
+
+        if (dx != 0)
+            scrollIn(pixels, format, pitch, dx > 0 ? 0 : keptWidth, dy > 0 ? dy : 0, w - keptWidth, keptHeight);
+        if (dy != 0)
+            scrollIn(pixels, format, pitch, 0, dy > 0 ? 0 : keptHeight, w, h - keptHeight);
+
+        ::XFlush(display_);
+
+        pumpEvents();
+
+        return true;
+    }
+
+    // move the part of the window showing the frame that stays in view when scrolling by dx, dy
+
+    void scrollWindow(int dx, int dy)
+    {
+        const int sourceX = dx < 0 ? -dx : 0;
+        const int sourceY = dy < 0 ? -dy : 0;
+        const int destX   = dx > 0 ? dx : 0;
+        const int destY   = dy > 0 ? dy : 0;
+
+        ::XCopyArea(display_, window_, window_, gc_, left_ + sourceX * scale_, top_ + sourceY * scale_,
+                    (width() - sourceX - destX) * scale_, (height() - sourceY - destY) * scale_,
+                    left_ + destX * scale_, top_ + destY * scale_);
+    }
+
+    // true if frames go out in tiles, see Transport
+
+    bool remote() const
+    {
+        return transport() == Transport::Remote || (transport() == Transport::Automatic && UnixConnection::remote());
+    }
+
+    // send only the tiles of the frame that differ from the frame we sent last, within the bandwidth budget.
+    // updates that would go over the budget are skipped, their changes go out with the next update that fits.
+    // note: tiles always go straight to the window, they are not worth presenting through back pixmaps
+
+    bool updateTiles(const char* pixels, Format format, int pitch)
+    {
+        const int w       = width();
+        const int h       = height();
+        const int rowSize = w * bytesPerPixel_;
+
+        if (!withinBandwidth())
+        {
+            pumpEvents();
+            return true;
+        }
+
+        int         framePitch = rowSize;
+        const char* frame      = findConversion(pixels, format, pitch, framePitch);
+        if (!frame)
+        {
+            storeConversion(pixels, format, pitch);
+            convert(pixels, format, pitch, 0, 0, w, h);
+            frame      = buffer_.get();
+            framePitch = rowSize;
+        }
+
+        if (!sendTiles(frame, framePitch))
+            return false;
+
+        pumpEvents();
+        return true;
+    }
+
+    // top up the credit of the bandwidth budget, false if there is none left to send with
+
+    bool withinBandwidth()
+    {
+        if (bandwidth() <= 0)
+            return true;
+
+        // note: credit builds up to a second of budget at most, so an idle display can't burst later
+
+        const double now = monotonicTime();
+        credit_ += (now - lastSend_) * bandwidth();
+        lastSend_ = now;
+        if (credit_ > bandwidth())
+            credit_ = bandwidth();
+
+        return credit_ > 0.0;
+    }
+
+    // send the tiles of a frame in our format that differ from the frame we sent last.
+    // note: leaves pumping events to the caller, so a group can pump once for all its displays
+
+    bool sendTiles(const char* frame, int framePitch)
+    {
+        const int w       = width();
+        const int h       = height();
+        const int rowSize = w * bytesPerPixel_;
+
+        if (!sentValid_ && !sent_.reserve(rowSize * h))
+            return false;
+
+        // put runs of changed tiles next to each other in one image, one tile row at a time
+
+        integer64 bytes = 0;
+
+        for (int y = 0; y < h; y += tileSize_)
+        {
+            const int rows = y + tileSize_ < h ? tileSize_ : h - y;
+            int       run  = -1; // first column of the changed tiles not put yet
+
+            for (int x = 0;; x += tileSize_)
+            {
+                if (x < w && updateTile(frame, framePitch, x, y, x + tileSize_ < w ? tileSize_ : w - x, rows))
+                {
+                    if (run < 0)
+                        run = x;
+                    continue;
+                }
+
+                if (run >= 0)
+                {
+                    const int end = x < w ? x : w;
+                    put(window_, frame, framePitch, run, y, end - run, rows);
+                    bytes += static_cast<integer64>(end - run) * rows * bytesPerPixel_;
+                    run = -1;
+                }
+
+                if (x >= w)
+                    break;
+            }
+        }
+
+        sentValid_ = true;
+        credit_ -= bytes;
+
+        if (bytes > 0)
+            ::XFlush(display_);
+
+        return true;
+    }
+
+    // copy a tile of the frame over the frame we sent last, true if it was different
+
+    bool updateTile(const char* frame, int pitch, int x, int y, int columns, int rows)
+    {
+        const int   rowSize = width() * bytesPerPixel_;
+        const int   size    = columns * bytesPerPixel_;
+        const char* source  = frame + y * pitch + x * bytesPerPixel_;
+        char*       sent    = sent_.get() + y * rowSize + x * bytesPerPixel_;
+
+        int row = 0;
+
+        if (sentValid_)
+        {
+            while (row < rows && memcmp(source + row * pitch, sent + row * rowSize, size) == 0)
+                row++;
+            if (row == rows)
+                return false;
+        }
+
+        // note: the rows before the first difference are the same already
+
+        for (; row < rows; ++row)
+            memcpy(sent + row * rowSize, source + row * pitch, size);
+
+        return true;
+    }
+
+    // updates a group of displays on the shared connection.
+    //
+    // the frames are converted whole and in parallel, each thread taking the next display
+    // that still needs converting, and displays showing the same pixels in the same format
+    // share a single conversion. then all the images are put, the connection is flushed
+    // once and events are pumped once for the whole group.
+
+    static bool updateGroup(DisplayInterface* const displays[], const TrueColorPixel* const trueColorPixels[], const FloatingPointPixel* const floatingPointPixels[], int count)
+    {
+        bool result = true;
+
+        // note: groups hold at most DisplayGroup::MaximumDisplays, so the scratch arrays fit on the stack
+
+        if (count > DisplayGroup::MaximumDisplays)
+            count = DisplayGroup::MaximumDisplays;
+
+        UnixDisplay* ready[DisplayGroup::MaximumDisplays];
+        const char*  converted[DisplayGroup::MaximumDisplays];
+        const void*  pixels[DisplayGroup::MaximumDisplays];
+        Format       formats[DisplayGroup::MaximumDisplays];
+
+        for (int i = 0; i < count; ++i)
+        {
+            UnixDisplay* display = static_cast<UnixDisplay*>(displays[i]);
+
+            pixels[i]  = trueColorPixels[i] ? (const void*)trueColorPixels[i] : (const void*)floatingPointPixels[i];
+            formats[i] = trueColorPixels[i] ? Format::XRGB8888 : Format::XBGRFFFF;
+
+            if (display->beginUpdate(pixels[i], formats[i]))
+            {
+                ready[i] = display;
+
+                // remote displays over their bandwidth budget skip the frame, like their own updates do
+
+                if (display->remote() && !display->withinBandwidth())
+                {
+                    converted[i] = nullptr;
+                    continue;
+                }
+
+                // note: decided up front, so the conversion we share is done by the time we put it
+
+                const int pitch = display->width() * pixelSize(formats[i]);
+                int       convertedPitch;
+
+                converted[i] = display->findConversion(pixels[i], formats[i], pitch, convertedPitch);
+                if (!converted[i])
+                {
+                    display->storeConversion(pixels[i], formats[i], pitch);
+                    converted[i] = display->buffer_.get();
+                }
+            }
+            else
+            {
+                ready[i]     = nullptr;
+                converted[i] = nullptr;
+                result       = false;
+            }
+        }
+
+        ConversionJob job;
+        job.displays  = ready;
+        job.converted = converted;
+        job.pixels    = pixels;
+        job.formats   = formats;
+        job.count     = count;
+        job.next      = 0;
+
+        helpers_.run(convertJob, &job, count - 1);
+
+        // all frames are converted, send them to the server together
+
+        ::Display* connection = nullptr;
+
+        for (int i = 0; i < count; ++i)
+        {
+            UnixDisplay* display = ready[i];
+            if (!display)
+                continue;
+
+            connection = display->display_;
+
+            if (!converted[i])
+                continue;
+
+            const int pitch = display->width() * display->bytesPerPixel_;
+
+            // remote displays send only the tiles that changed, within their bandwidth budget
+
+            if (display->remote())
+            {
+                if (!display->sendTiles(converted[i], pitch))
+                    result = false;
+                continue;
+            }
+
+            display->sentValid_ = false;
+
+            const ::Drawable target = display->beginPresent();
+
+            display->put(target, converted[i], pitch, 0, 0, display->width(), display->height());
+
+            display->endPresent();
+        }
+
+        if (!connection)
+            return result;
+
+        ::XFlush(connection);
+
+        UnixConnection::dispatch();
+
+        for (int i = 0; i < count; ++i)
+        {
+            UnixDisplay* display = ready[i];
+            if (display && display->display_)
+                display->sendKeyEvents();
+        }
+
+        return result;
+    }
+
+    void title(const char title[]) override
+    {
+        DisplayAdapter::title(title);
+
+        if (display_ && window_)
+            ::XStoreName(display_, window_, title);
+    }
+
+    bool waitEvents(double timeout) override
+    {
+        if (!display_)
+            return false;
+
+        const double deadline = timeout < 0.0 ? -1.0 : monotonicTime() + timeout;
+
+        // note: events may already be waiting in xlib's queue, in which case the socket has nothing to say
+
+        while (::XPending(display_) == 0)
+        {
+            if (!waitReadable(ConnectionNumber(display_), deadline))
+                return false;
+        }
+
+        pumpEvents();
+
+#ifdef PIXELTOASTER_USE_PRESENT
+        if (presenter_.open())
+            presenter_.pumpEvents();
+#endif
+
+        if (isShuttingDown_)
+            close();
+
+        return true;
+    }
+
+    Format format() const override
+    {
+        return destFormat_;
+    }
+
+    // note: only the changed entries are converted, the next update looks the indices up with them
+
+    void palette(const TrueColorPixel colors[], int first, int count) override
+    {
+        DisplayAdapter::palette(colors, first, count);
+
+        if (bytesPerPixel_)
+            loadPalette(first, count);
+    }
+
+    const TrueColorPixel* palette() const override
+    {
+        return DisplayAdapter::palette();
+    }
+
+    // note: floating point pixels get their converter selected again on the next update
+
+    void quality(Quality quality) override
+    {
+        DisplayAdapter::quality(quality);
+        sourceFormat_ = Format::Unknown;
+    }
+
+    Quality quality() const override
+    {
+        return DisplayAdapter::quality();
+    }
+
+    static void* allocatePixels(integer64 bytes)
+    {
+        return allocatePixelMemory(bytes);
+    }
+
+    static void freePixels(void* pixels)
+    {
+        freePixelMemory(pixels);
+    }
+
+    // forget shared conversions of the given pixels, or of all pixels if null
+
+    static void invalidate(const void* pixels)
+    {
+        for (int i = 0; i < cacheSize_; ++i)
+        {
+            if (!pixels || cache_[i].key.source == pixels)
+                cache_[i].owner = nullptr;
+        }
+    }
+
+    bool timing(Timing& timing) const override
+    {
+#ifdef PIXELTOASTER_USE_PRESENT
+        return presenter_.open() && presenter_.timing(timing);
+#else
+        return false;
+#endif
+    }
+
+protected:
+    void defaults() override
+    {
+        DisplayAdapter::defaults();
+
+        display_ = 0;
+        window_  = 0;
+        gc_       = 0;
+        image_    = 0;
+        cursor_   = 0;
+        colormap_ = 0;
+        buffer_.reset();
+        scaled_.reset();
+        depth_                  = 0;
+        scale_                  = 1;
+        left_                   = 0;
+        top_                    = 0;
+        windowWidth_            = 0;
+        windowHeight_           = 0;
+        trueColorConverter_     = 0;
+        floatingPointConverter_ = 0;
+        sourceFormat_           = Format::Unknown;
+        sourceConverter_        = 0;
+        chainConverter_         = 0;
+        isShuttingDown_         = false;
+        translucent_            = false;
+        swapBytes_              = false;
+        destFormat_             = Format::Unknown;
+        bytesPerPixel_          = 0;
+        generation_             = 0;
+        ownFrame_               = false;
+        sent_.reset();
+        sentValid_              = false;
+        credit_                 = 0.0;
+        lastSend_               = 0.0;
+        keys_.reset();
+        motion_.reset();
+#ifdef PIXELTOASTER_USE_PRESENT
+        presenting_ = false;
+#endif
+    }
+
+private:
+    enum
+    {
+        eventMask_ = KeyPressMask | KeyReleaseMask | ButtonPressMask | ButtonReleaseMask | PointerMotionMask | ButtonMotionMask | ExposureMask | FocusChangeMask | StructureNotifyMask,
+        cacheSize_ = 8,
+        tileSize_  = 32
+    };
+
+    typedef DirtyVector<char> TBuffer;
+
+    friend class UnixConnection;
+
+    // the displays of a group update still waiting to be converted
+
+    struct ConversionJob
+    {
+        UnixDisplay* const* displays;
+        const char* const*  converted;
+        const void* const*  pixels;
+        const Format*       formats;
+        int                 count;
+        int                 next;
+    };
+
+    static void* convertJob(void* data)
+    {
+        ConversionJob& job = *static_cast<ConversionJob*>(data);
+
+        while (true)
+        {
+            const int i = __sync_fetch_and_add(&job.next, 1);
+            if (i >= job.count)
+                break;
+
+            // note: displays that share another display's conversion or need none have nothing to do
+
+            UnixDisplay* display = job.displays[i];
+            if (display && job.converted[i] == display->buffer_.get())
+                display->convert(job.pixels[i], job.formats[i], display->width() * pixelSize(job.formats[i]), 0, 0, display->width(), display->height());
+        }
+
+        return nullptr;
+    }
+
+    bool beginUpdate(const void* pixels, Format format)
+    {
+        if (isShuttingDown_)
+        {
+            close();
+            return false;
+        }
+
+        if (!display_ || !window_ || !image_)
+            return false;
+
+        return pixels && selectConverter(format);
+    }
+
+    // get ready to convert pixels of the given format to ours, false if we can't.
+    // formats without a converter to ours are converted through truecolor.
+
+    bool selectConverter(Format format)
+    {
+        if (format == destFormat_ && !swapBytes_)
+            return true;
+
+        if (format == Format::Indexed8)
+        {
+            // note: the palette is in the server's byte order already, see loadPalette
+
+            sourceFormat_    = format;
+            sourceConverter_ = &paletteConverter_;
+            chainConverter_  = 0;
+        }
+        else if (format != sourceFormat_)
+        {
+            sourceFormat_    = format;
+            sourceConverter_ = format == destFormat_ ? 0 : requestConverter(format, destFormat_);
+            chainConverter_  = 0;
+
+            if (format == Format::XBGRFFFF && quality() == Quality::Fast && fastConverter_.select(destFormat_))
+                sourceConverter_ = &fastConverter_;
+
+            if (!sourceConverter_ && format != destFormat_)
+            {
+                // note: formats that convert through truecolor have no alpha, so they are opaque on translucent windows
+
+                sourceConverter_ = requestConverter(format, Format::XRGB8888);
+                chainConverter_  = destFormat_ == Format::ARGB8888 ? &opaqueConverter_ : trueColorConverter_;
+            }
+
+            // the last converter swaps the bytes for the server, pixels in our format are just swapped
+
+            if (swapBytes_ && chainConverter_)
+            {
+                swapped_.select(chainConverter_, 4, bytesPerPixel_);
+                chainConverter_ = &swapped_;
+            }
+            else if (swapBytes_)
+            {
+                swapped_.select(sourceConverter_, pixelSize(format), bytesPerPixel_);
+                sourceConverter_ = &swapped_;
+            }
+        }
+
+        return sourceConverter_ != 0;
+    }
+
+    // convert palette entries to our format, swapped for the server if need be
+
+    void loadPalette(int first, int count)
+    {
+        Converter_Swapped swapped;
+        swapped.select(trueColorConverter_, 4, bytesPerPixel_);
+
+        paletteConverter_.palette(palette(), first, count, swapBytes_ ? &swapped : trueColorConverter_, bytesPerPixel_);
+    }
+
+    // a frame converted by one display, shared with every other display that shows
+    // the same pixels in the same format and quality, see ConversionKey. the converted pixels live in the buffer of
+    // the display that converted them, so each display owns at most one cached frame.
+    //
+    // we can't see when the caller changes the pixels, so we assume a new frame has
+    // started once a display that already showed a cached frame is updated with the
+    // same pixels again. anything else has to be made explicit with Display::invalidate.
+
+    struct CachedFrame
+    {
+        ConversionKey key;
+        UnixDisplay*  owner;
+        integer32     generation;
+    };
+
+    // get pixels in our format without converting, or null if we have to convert them ourselves.
+    // source rows are pitch bytes apart, the rows of the pixels we return are resultPitch bytes apart.
+
+    const char* findConversion(const void* source, Format sourceFormat, int pitch, int& resultPitch)
+    {
+        ownFrame_ = false;
+
+        if (sourceFormat == destFormat_ && !swapBytes_)
+        {
+            generation_ = 0;
+            resultPitch = pitch;
+            return (const char*)source;
+        }
+
+        // note: each display has its own palette, so indices converted by another display may have other colors
+
+        if (sourceFormat == Format::Indexed8)
+            return nullptr;
+
+        const ConversionKey key(source, width() * height(), pitch, sourceFormat, destFormat_, quality());
+
+        for (int i = 0; i < cacheSize_; ++i)
+        {
+            const CachedFrame& frame = cache_[i];
+            if (frame.owner && frame.key == key)
+            {
+                if (frame.generation == generation_)
+                    return nullptr;
+
+                generation_ = frame.generation;
+                resultPitch = width() * bytesPerPixel_;
+                return frame.owner->buffer_.get();
+            }
+        }
+
+        return nullptr;
+    }
+
+    // note that our buffer is about to receive a conversion of these pixels
+
+    void storeConversion(const void* source, Format sourceFormat, int pitch)
+    {
+        const ConversionKey key(source, width() * height(), pitch, sourceFormat, destFormat_, quality());
+
+        // drop our previous frame and any older conversion of the same pixels, then take the oldest slot
+
+        int slot = 0;
+
+        for (int i = 0; i < cacheSize_; ++i)
+        {
+            CachedFrame& frame = cache_[i];
+            if (frame.owner == this || frame.key == key)
+                frame.owner = nullptr;
+
+            if (cache_[slot].owner && (!frame.owner || frame.generation < cache_[slot].generation))
+                slot = i;
+        }
+
+        CachedFrame& frame = cache_[slot];
+        frame.key          = key;
+        frame.owner        = this;
+        frame.generation   = ++lastGeneration_;
+
+        generation_ = frame.generation;
+        ownFrame_   = true;
+    }
+
+    // drop our frame, nobody can use it any more and we won't repaint from it either
+
+    void forgetConversion()
+    {
+        for (int i = 0; i < cacheSize_; ++i)
+        {
+            if (cache_[i].owner == this)
+                cache_[i].owner = nullptr;
+        }
+
+        generation_ = 0;
+        ownFrame_   = false;
+    }
+
+    // convert a rectangle of the frame into the image buffer, source rows are pitch bytes apart.
+    // note: touches nothing but the buffer, so displays may convert on different threads.
+
+    void convert(const void* pixels, Format format, int pitch, int x, int y, int columns, int rows)
+    {
+        const int   w          = width();
+        const int   sourceSize = pixelSize(format);
+        const char* source     = (const char*)pixels + y * pitch + x * sourceSize;
+        char*       dest       = buffer_.get() + (y * w + x) * bytesPerPixel_;
+
+        // whole packed rows go in one run, anything narrower a row at a time
+
+        if (columns == w && pitch == w * sourceSize)
+        {
+            convertRun(source, dest, sourceSize, w * rows);
+            return;
+        }
+
+        for (int row = 0; row < rows; ++row)
+            convertRun(source + row * pitch, dest + row * w * bytesPerPixel_, sourceSize, columns);
+    }
+
+    // convert rows of a frame of video into the image buffer
+
+    void convertVideo(const void* const planes[], const int pitches[], int y, int rows)
+    {
+        const int w       = width();
+        const int rowSize = w * bytesPerPixel_;
+
+        for (int row = y; row < y + rows; ++row)
+        {
+            char* dest = buffer_.get() + row * rowSize;
+
+            videoConverter_.convert(planes, pitches, 0, row, dest, w);
+
+            if (swapBytes_ && bytesPerPixel_ == 2)
+                swap_bytes((const integer16*)dest, (integer16*)dest, w);
+            else if (swapBytes_)
+                swap_bytes((const integer32*)dest, (integer32*)dest, w);
+        }
+    }
+
+    // show a rectangle of the frame that was just scrolled into view
+
+    void scrollIn(const void* pixels, Format format, int pitch, int x, int y, int columns, int rows)
+    {
+        if (format == destFormat_ && !swapBytes_)
+        {
+            put(window_, (const char*)pixels, pitch, x, y, columns, rows);
+            return;
+        }
+
+        convert(pixels, format, pitch, x, y, columns, rows);
+        put(window_, buffer_.get(), width() * bytesPerPixel_, x, y, columns, rows);
+    }
+
+    void convertRun(const char* source, char* dest, int sourceSize, int count)
+    {
+        if (!chainConverter_)
+        {
+            sourceConverter_->convert(source, dest, count);
+            return;
+        }
+
+        Converter* const converter = sourceConverter_;
+
+        ConverterAdapter::convertChained([=](int first, integer32 chunk[], int chunkCount) { converter->convert(source + first * sourceSize, chunk, chunkCount); },
+                                         chainConverter_, dest, bytesPerPixel_, count);
+    }
+
+    // put a rectangle of a frame in our format on the target, scaled and placed as laid out.
+    // frame rows are pitch bytes apart, so the server can read a viewport of a wider canvas directly.
+    // note: the presenter's pixmaps hold just the scaled frame, only the window has a border around it
+
+    void put(::Drawable target, const char* pixels, int pitch, int x, int y, int w, int h)
+    {
+        const int left        = target == window_ ? left_ : 0;
+        const int top         = target == window_ ? top_ : 0;
+        const int packedPitch = image_->bytes_per_line;
+
+        if (scale_ > 1)
+        {
+            if (bytesPerPixel_ == 2)
+                scalePixels((const unsigned short*)pixels, pitch / 2, (unsigned short*)scaled_.get(), width(), x, y, w, h, scale_);
+            else if (bytesPerPixel_ == 3)
+                scalePixels((const Packed24*)pixels, pitch / 3, (Packed24*)scaled_.get(), width(), x, y, w, h, scale_);
+            else
+                scalePixels((const integer32*)pixels, pitch / 4, (integer32*)scaled_.get(), width(), x, y, w, h, scale_);
+
+            pixels = scaled_.get();
+            pitch  = packedPitch;
+            x *= scale_;
+            y *= scale_;
+            w *= scale_;
+            h *= scale_;
+        }
+
+        image_->data           = const_cast<char*>(pixels);
+        image_->bytes_per_line = pitch;
+        ::XPutImage(display_, target, gc_, image_, x, y, left + x, top + y, w, h);
+        image_->data           = nullptr;
+        image_->bytes_per_line = packedPitch;
+    }
+
+    // where on the screen the window goes and how big it is.
+    // fullscreen windows cover a whole monitor, after switching its mode if we can.
+
+    void placeWindow(int& left, int& top, int& windowWidth, int& windowHeight)
+    {
+        const int screen = DefaultScreen(display_);
+
+        int monitorLeft   = 0;
+        int monitorTop    = 0;
+        int monitorWidth  = DisplayWidth(display_, screen);
+        int monitorHeight = DisplayHeight(display_, screen);
+
+#ifdef PIXELTOASTER_USE_RANDR
+        // optional: without randr we stay in the current mode and scale the frame up instead
+        if (output() == Output::Fullscreen && modeSwitch_.enter(display_, width(), height()))
+            modeSwitch_.monitor(monitorLeft, monitorTop, monitorWidth, monitorHeight);
+#endif
+
+        if (output() == Output::Fullscreen)
+        {
+            windowWidth  = monitorWidth > width() ? monitorWidth : width();
+            windowHeight = monitorHeight > height() ? monitorHeight : height();
+            left         = monitorLeft;
+            top          = monitorTop;
+        }
+        else
+        {
+            windowWidth  = width();
+            windowHeight = height();
+            left         = monitorLeft + (monitorWidth - width()) / 2;
+            top          = monitorTop + (monitorHeight - height()) / 2;
+        }
+    }
+
+    void setSizeHints(int left, int top)
+    {
+        ::XSizeHints sizeHints;
+        sizeHints.flags = PPosition | PMinSize | PMaxSize;
+        sizeHints.x = sizeHints.y = 0;
+        sizeHints.min_width = sizeHints.max_width = width();
+        sizeHints.min_height = sizeHints.max_height = height();
+        if (output() == Output::Fullscreen)
+        {
+            // note: a window that can't change size can't be made fullscreen by the window manager
+            sizeHints.flags = PPosition;
+            sizeHints.x     = left;
+            sizeHints.y     = top;
+        }
+        else if (resizable())
+        {
+            sizeHints.flags      = PPosition | PMinSize;
+            sizeHints.min_width  = 1;
+            sizeHints.min_height = 1;
+        }
+        ::XSetNormalHints(display_, window_, &sizeHints);
+    }
+
+    // place the frame in a window of the given size, scaling it up if the window is fullscreen.
+    // the image and the presenter's pixmaps are recreated only when the scale or the frame size changes.
+
+    bool layout(int windowWidth, int windowHeight)
+    {
+        const int w = width();
+        const int h = height();
+
+        // note: the frame moves or the window is cleared, either way we have to send it whole again
+
+        sentValid_ = false;
+
+        int scale = 1;
+        if (output() == Output::Fullscreen)
+        {
+            scale = windowWidth / w < windowHeight / h ? windowWidth / w : windowHeight / h;
+            if (scale < 1)
+                scale = 1;
+        }
+
+        // note: a frame bigger than the window is cut off on the right and bottom
+
+        left_         = windowWidth > w * scale ? (windowWidth - w * scale) / 2 : 0;
+        top_          = windowHeight > h * scale ? (windowHeight - h * scale) / 2 : 0;
+        windowWidth_  = windowWidth;
+        windowHeight_ = windowHeight;
+
+        if (image_ && scale == scale_ && image_->width == w * scale && image_->height == h * scale)
+            return true;
+
+        scale_ = scale;
+
+        if (image_)
+        {
+            XDestroyImage(image_);
+            image_ = 0;
+        }
+
+        if (scale == 1)
+            scaled_.reset();
+        else if (!scaled_.reserve(w * scale * h * scale * bytesPerPixel_))
+            return false;
+
+        // note: rows of packed 24 bit pixels are only byte aligned
+        image_ = ::XCreateImage(display_, CopyFromParent, depth_, ZPixmap, 0, 0,
+                                w * scale, h * scale, bytesPerPixel_ == 3 ? 8 : 8 * bytesPerPixel_, w * scale * bytesPerPixel_);
+        if (!image_)
+            return false;
+        image_->byte_order = ImageByteOrder(display_); // note: our pixels are in the server's byte order already
+
+#ifdef PIXELTOASTER_USE_PRESENT
+        // optional: fall back to plain XPutImage presentation if the server lacks the present extension
+        presenter_.close();
+        presenter_.open(display_, window_, w * scale, h * scale, depth_);
+#endif
+
+        return true;
+    }
+
+    // window coordinates of the mouse to frame coordinates
+
+    float frameX(int x) const
+    {
+        return static_cast<float>(x - left_) / scale_;
+    }
+
+    float frameY(int y) const
+    {
+        return static_cast<float>(y - top_) / scale_;
+    }
+
+    // repaint the uncovered part of the window from the frame we already have,
+    // without converting again or calling back into the application.
+    // note: truecolor frames we sent straight from the caller's pixels are not kept,
+    // those parts stay blank until the next update.
+
+    void repaint(int windowX, int windowY, int windowWidth, int windowHeight)
+    {
+        const char* pixels = shownPixels();
+        if (!pixels || !image_)
+            return;
+
+        // the frame pixels covering the exposed part of the window, the border is the background
+
+        int x = windowX - left_;
+        int y = windowY - top_;
+        int r = (x + windowWidth + scale_ - 1) / scale_;
+        int b = (y + windowHeight + scale_ - 1) / scale_;
+        x     = x > 0 ? x / scale_ : 0;
+        y     = y > 0 ? y / scale_ : 0;
+        r     = r < width() ? r : width();
+        b     = b < height() ? b : height();
+        if (r > x && b > y)
+            put(window_, pixels, width() * bytesPerPixel_, x, y, r - x, b - y);
+    }
+
+    // get the pixels of the frame on screen, or null if we no longer have them
+
+    const char* shownPixels()
+    {
+        if (sentValid_)
+            return sent_.get();
+
+        if (ownFrame_)
+            return buffer_.get();
+
+        // note: another display's conversion is only ours to use while it still holds the frame we showed
+
+        for (int i = 0; i < cacheSize_; ++i)
+        {
+            if (cache_[i].owner && generation_ && cache_[i].generation == generation_)
+                return cache_[i].owner->buffer_.get();
+        }
+
+        return nullptr;
+    }
+
+    ::Drawable beginPresent()
+    {
+#ifdef PIXELTOASTER_USE_PRESENT
+        presenting_ = presentation() != Presentation::Default && presenter_.open();
+        if (presenting_)
+            return presenter_.begin(presentation());
+#endif
+        return window_;
+    }
+
+    void endPresent()
+    {
+#ifdef PIXELTOASTER_USE_PRESENT
+        if (presenting_)
+            presenter_.present(presentation(), left_, top_);
+        if (presenter_.open())
+            presenter_.pumpEvents();
+#endif
+    }
+
+    void pumpEvents()
+    {
+        UnixConnection::dispatch();
+        sendKeyEvents();
+    }
+
+    void flushMotion()
+    {
+        motion_.flush(listener(), wrapper() ? *wrapper() : *(DisplayInterface*)this);
+    }
+
+    void sendKeyEvents()
+    {
+        // send key press and up events
+
+        keys_.send(listener(), wrapper() ? *wrapper() : *(DisplayInterface*)this);
+    }
+
+    void handleEvent(const ::XEvent& event)
+    {
+        // keep mouse moves in order with the other input events
+
+        if (event.type != MotionNotify)
+            flushMotion();
+
+        switch (event.type)
+        {
+            case KeyPress:
+            case KeyRelease:
+            {
+                const KeySym keySym = ::XkbKeycodeToKeysym(display_, event.xkey.keycode, 0, 0);
+                const Key    key    = UnixKeyMap::translate(keySym);
+
+                if (event.type == KeyPress)
+                {
+                    if (keys_.press(key))
+                    {
+                        queueEvent(Event::KeyDown, monotonicTime(), key, nullptr, false);
+
+                        bool defaultKeyHandlers = true;
+
+                        if (listener())
+                        {
+                            listener()->onKeyDown(wrapper() ? *wrapper() : *(DisplayInterface*)this, key);
+                            defaultKeyHandlers = listener()->defaultKeyHandlers();
+                        }
+
+                        if (defaultKeyHandlers && key == Key::Escape)
+                        {
+                            isShuttingDown_ = true;
+                        }
+                    }
+                }
+                else
+                {
+                    if (keys_.release(key))
+                        queueEvent(Event::KeyUp, monotonicTime(), key, nullptr, false);
+                }
+                break;
+            }
+
+            case ButtonPress:
+            case ButtonRelease:
+            {
+                Mouse mouse;
+                mouse.x              = frameX(event.xbutton.x);
+                mouse.y              = frameY(event.xbutton.y);
+                mouse.buttons.left   = event.xbutton.button == Button1;
+                mouse.buttons.middle = event.xbutton.button == Button2;
+                mouse.buttons.right  = event.xbutton.button == Button3;
+                queueEvent(event.type == ButtonPress ? Event::MouseButtonDown : Event::MouseButtonUp, monotonicTime(), Key(), &mouse, false);
+                if (event.type == ButtonPress)
+                {
+                    if (listener())
+                        listener()->onMouseButtonDown(wrapper() ? *wrapper() : *(DisplayInterface*)this, mouse);
+                }
+                else
+                {
+                    if (listener())
+                        listener()->onMouseButtonUp(wrapper() ? *wrapper() : *(DisplayInterface*)this, mouse);
+                }
+                break;
+            }
+            case MotionNotify:
+            {
+                Mouse mouse;
+                mouse.x              = frameX(event.xmotion.x);
+                mouse.y              = frameY(event.xmotion.y);
+                mouse.buttons.left   = event.xmotion.state & Button1Mask;
+                mouse.buttons.middle = event.xmotion.state & Button2Mask;
+                mouse.buttons.right  = event.xmotion.state & Button3Mask;
+                queueEvent(Event::MouseMove, monotonicTime(), Key(), &mouse, false);
+                if (coalesceMouseMotion())
+                    motion_.add(listener(), wrapper() ? *wrapper() : *(DisplayInterface*)this, mouse);
+                else if (listener())
+                    listener()->onMouseMove(wrapper() ? *wrapper() : *(DisplayInterface*)this, mouse);
+                break;
+            }
+            case FocusIn:
+            case FocusOut:
+            {
+                // note: focus moving between our window and its children is no change for the user
+
+                if (event.xfocus.detail == NotifyInferior)
+                    break;
+
+                // keys held when we lose focus never see their key releases, so let go of them now
+
+                const bool active = event.type == FocusIn;
+
+                if (!active)
+                {
+                    Key       released[256];
+                    const int count = keys_.releaseAll(released);
+
+                    for (int i = 0; i < count; ++i)
+                        queueEvent(Event::KeyUp, monotonicTime(), released[i], nullptr, false);
+                }
+
+                queueEvent(Event::Activate, monotonicTime(), Key(), nullptr, active);
+                if (listener())
+                    listener()->onActivate(wrapper() ? *wrapper() : *(DisplayInterface*)this, active);
+                break;
+            }
+
+            case Expose:
+            {
+                repaint(event.xexpose.x, event.xexpose.y, event.xexpose.width, event.xexpose.height);
+
+                if (event.xexpose.count == 0)
+                    ::XFlush(display_);
+                break;
+            }
+
+            case GraphicsExpose:
+            {
+                // part of the window we scrolled from was covered, so the copy left a hole behind
+
+                repaint(event.xgraphicsexpose.x, event.xgraphicsexpose.y, event.xgraphicsexpose.width, event.xgraphicsexpose.height);
+
+                if (event.xgraphicsexpose.count == 0)
+                    ::XFlush(display_);
+                break;
+            }
+
+            case ConfigureNotify:
+            {
+                // the user resized the window, or the window manager made us fullscreen on a monitor of
+                // another size or didn't at all. a resizable window takes the new size if the listener agrees.
+                // note: the server exposes the whole window after a resize, which repaints it
+
+                const int windowWidth  = event.xconfigure.width;
+                const int windowHeight = event.xconfigure.height;
+
+                if (windowWidth == windowWidth_ && windowHeight == windowHeight_)
+                    break;
+
+                if (resizable() && output() != Output::Fullscreen && listener() &&
+                    listener()->onResize(wrapper() ? *wrapper() : *(DisplayInterface*)this, windowWidth, windowHeight))
+                {
+                    forgetConversion();
+                    DisplayAdapter::resize(windowWidth, windowHeight);
+                    if (!buffer_.reserve(windowWidth * windowHeight * bytesPerPixel_))
+                    {
+                        isShuttingDown_ = true;
+                        break;
+                    }
+                }
+
+                if (!layout(windowWidth, windowHeight))
+                    isShuttingDown_ = true;
+                break;
+            }
+
+            case ClientMessage:
+            {
+                if (event.xclient.message_type == UnixConnection::atom(UnixConnection::WMProtocols) &&
+                    event.xclient.format == 32 &&
+                    event.xclient.data.l[0] == (long)UnixConnection::atom(UnixConnection::WMDeleteWindow))
+                {
+                    queueEvent(Event::Close, monotonicTime(), Key(), nullptr, false);
+
+                    if (listener())
+                    {
+                        if (listener()->onClose(wrapper() ? *wrapper() : *(DisplayInterface*)this))
+                            isShuttingDown_ = true;
+                    }
+                    else
+                    {
+                        isShuttingDown_ = true;
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    ::Display*   display_;
+    ::Window     window_;
+    ::GC         gc_;
+    ::XImage*    image_;
+    ::Cursor     cursor_;   // blank cursor of a fullscreen window
+    ::Colormap   colormap_; // colormap of the alpha visual of a translucent window
+    TBuffer      buffer_;
+    TBuffer      scaled_; // the frame scaled up to fill a fullscreen window
+    int          depth_;
+    int          scale_;
+    int          left_; // where the frame is in the window
+    int          top_;
+    int          windowWidth_;
+    int          windowHeight_;
+    Converter*   trueColorConverter_;
+    Converter*   floatingPointConverter_;
+    Format       sourceFormat_;    // format the source converter was selected for
+    Converter*   sourceConverter_; // converts pixels of that format to ours, or to truecolor if chained
+    Converter*   chainConverter_;  // converts truecolor to ours when there is no direct converter
+    bool         isShuttingDown_;
+    bool         translucent_; // translucency requested when the window was created
+
+    Converter_XRGB8888_to_opaque_ARGB8888 opaqueConverter_;  // chain converter for formats without alpha on translucent windows
+    Converter_Indexed8                    paletteConverter_; // looks palette indices up in our format
+    Converter_YUV                         videoConverter_;   // converts video frames to our format
+    Converter_Fast                        fastConverter_;    // converts floating point pixels with Quality::Fast
+    Converter_Swapped                     swapped_;          // last converter of the source format when swapping bytes
+    bool                                  swapBytes_;        // the server takes pixels in the other byte order
+
+    Format       destFormat_;
+    int          bytesPerPixel_;
+    integer32    generation_; // generation of the cached frame we showed last
+    bool         ownFrame_;   // true if buffer_ holds the frame on screen
+    TBuffer      sent_;       // the frame on screen when sending tiles, see updateTiles
+    bool         sentValid_;  // true if sent_ holds the frame on screen
+    double       credit_;     // bytes we may still send within the bandwidth budget
+    double       lastSend_;   // time the credit was last topped up
+    UnixKeyState keys_;
+
+    MouseMotionBuffer motion_;
+
+#ifdef PIXELTOASTER_USE_PRESENT
+    UnixPresenter presenter_;
+    bool          presenting_;
+#endif
+
+#ifdef PIXELTOASTER_USE_RANDR
+    UnixModeSwitch modeSwitch_;
+#endif
+
+    static CachedFrame    cache_[cacheSize_];
+    static integer32      lastGeneration_;
+    static UnixWorkerPool helpers_; // converts the frames of group updates in parallel
+};
+
+inline void UnixConnection::dispatch()
+{
+    // note: a listener may close the last display while we are dispatching, or close or delete the
+    // display it was called for, so the previous display is looked up again before flushing it
+
+    UnixDisplay* previous       = nullptr;
+    ::Window     previousWindow = 0;
+
+    auto flushPrevious = [&]() {
+        XPointer owner = nullptr;
+        if (previous && display_ && ::XFindContext(display_, previousWindow, context_, &owner) == 0 && reinterpret_cast<UnixDisplay*>(owner) == previous)
+            previous->flushMotion();
+    };
+
+    ::XEvent event;
+    while (display_ && ::XPending(display_) > 0)
+    {
+        ::XNextEvent(display_, &event);
+
+        XPointer owner = nullptr;
+        if (::XFindContext(display_, event.xany.window, context_, &owner) == 0)
+        {
+            UnixDisplay* display = reinterpret_cast<UnixDisplay*>(owner);
+
+            // a run of events for one display ends, send its coalesced mouse moves
+
+            if (previous != display)
+                flushPrevious();
+
+            display->handleEvent(event);
+            previous       = display;
+            previousWindow = event.xany.window;
+        }
+    }
+
+    flushPrevious();
+}
 } // namespace PixelToaster
 
 // unix timer implementation
@@ -0,0 +1,814 @@
+// XCB Platform
+// Copyright © 2004-2007 Glenn Fiedler
+// Part of the PixelToaster Framebuffer Library - http://www.pixeltoaster.com
+
+// xcb display implementation.
+//
+// this is an alternative to the xlib display in PixelToasterUnix.h, selected at build time
+// by defining PIXELTOASTER_USE_XCB. instead of synchronous XPutImage calls and a forced
+// XFlush per band, every image request of a frame is queued on the connection and sent with
+// a single xcb_flush. requests are unchecked: errors come back asynchronously through the
+// event queue and are matched against the sequence numbers of the requests we issued.
+// when the server is local and supports MIT-SHM, pixels are converted straight into a
+// shared memory segment and sent with xcb_shm_put_image, so no pixel data crosses the socket.
+
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <xcb/xcb.h>
+#include <xcb/shm.h>
+
+namespace PixelToaster {
+class XcbDisplay : public DisplayAdapter
+{
+public:
+    XcbDisplay()
+    {
+        defaults();
+    }
+
+    bool open(const char title[], int width, int height, Output output, Mode mode) override
+    {
+        DisplayAdapter::open(title, width, height, output, mode);
+
+        // let's open a connection
+
+        int screenNumber = 0;
+
+        connection_ = ::xcb_connect(nullptr, &screenNumber);
+        if (::xcb_connection_has_error(connection_))
+        {
+            close();
+            return false;
+        }
+
+        // queue up every request we need a reply for, so they cost a single round trip
+
+        ::xcb_prefetch_extension_data(connection_, &xcb_shm_id);
+        ::xcb_prefetch_maximum_request_length(connection_);
+
+        const char protocolsName[]    = "WM_PROTOCOLS";
+        const char deleteWindowName[] = "WM_DELETE_WINDOW";
+
+        xcb_intern_atom_cookie_t protocolsCookie    = ::xcb_intern_atom(connection_, 1, sizeof(protocolsName) - 1, protocolsName);
+        xcb_intern_atom_cookie_t deleteWindowCookie = ::xcb_intern_atom(connection_, 1, sizeof(deleteWindowName) - 1, deleteWindowName);
+
+        const xcb_setup_t* setup = ::xcb_get_setup(connection_);
+
+        xcb_get_keyboard_mapping_cookie_t keyboardCookie = ::xcb_get_keyboard_mapping(connection_, setup->min_keycode,
+                                                                                      setup->max_keycode - setup->min_keycode + 1);
+
+        // find our screen, its visual and the image format the server wants for it
+
+        xcb_screen_iterator_t screens = ::xcb_setup_roots_iterator(setup);
+        for (int i = 0; i < screenNumber; ++i)
+            ::xcb_screen_next(&screens);
+
+        screen_ = screens.data;
+
+        const xcb_visualtype_t* visual = findVisual(screen_, screen_->root_visual);
+        if (!visual)
+        {
+            discardReplies(protocolsCookie, deleteWindowCookie, keyboardCookie);
+            close();
+            return false;
+        }
+
+        depth_ = screen_->root_depth;
+
+        int bitsPerPixel = 0;
+        int scanlinePad  = 0;
+
+        for (xcb_format_iterator_t formats = ::xcb_setup_pixmap_formats_iterator(setup); formats.rem; ::xcb_format_next(&formats))
+        {
+            if (formats.data->depth == depth_)
+            {
+                bitsPerPixel = formats.data->bits_per_pixel;
+                scanlinePad  = formats.data->scanline_pad;
+            }
+        }
+
+#if defined(PIXELTOASTER_LITTLE_ENDIAN)
+        const int clientByteOrder = XCB_IMAGE_ORDER_LSB_FIRST;
+#else
+        const int clientByteOrder = XCB_IMAGE_ORDER_MSB_FIRST;
+#endif
+
+        if (bitsPerPixel != 16 && bitsPerPixel != 32)
+        {
+            discardReplies(protocolsCookie, deleteWindowCookie, keyboardCookie);
+            close();
+            return false;
+        }
+
+        bytesPerPixel_ = bitsPerPixel / 8;
+        pitch_         = ((width * bitsPerPixel + scanlinePad - 1) / scanlinePad) * scanlinePad / 8;
+
+        // xcb does not swap image data for us, so servers with the other byte order get pixels swapped by the converters
+
+        swapBytes_          = setup->image_byte_order != clientByteOrder;
+        destFormat_         = findFormat(bitsPerPixel, visual->red_mask, visual->green_mask, visual->blue_mask);
+        trueColorConverter_ = requestConverter(Format::XRGB8888, destFormat_);
+        if (!trueColorConverter_ || !selectFloatingPointConverter())
+        {
+            discardReplies(protocolsCookie, deleteWindowCookie, keyboardCookie);
+            close();
+            return false;
+        }
+
+        if (swapBytes_)
+        {
+            swappedTrueColor_.select(trueColorConverter_, sizeof(TrueColorPixel), bytesPerPixel_);
+            trueColorConverter_ = &swappedTrueColor_;
+        }
+
+        // let's create a window
+
+        const int left = (screen_->width_in_pixels - width) / 2;
+        const int top  = (screen_->height_in_pixels - height) / 2;
+
+        const uint32_t windowValues[] = {screen_->black_pixel, screen_->black_pixel, XCB_BACKING_STORE_NOT_USEFUL, eventMask_};
+
+        window_ = ::xcb_generate_id(connection_);
+        ::xcb_create_window(connection_, XCB_COPY_FROM_PARENT, window_, screen_->root, left, top, width, height, 0,
+                            XCB_WINDOW_CLASS_INPUT_OUTPUT, screen_->root_visual,
+                            XCB_CW_BACK_PIXEL | XCB_CW_BORDER_PIXEL | XCB_CW_BACKING_STORE | XCB_CW_EVENT_MASK, windowValues);
+
+        ::xcb_change_property(connection_, XCB_PROP_MODE_REPLACE, window_, XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, strlen(title), title);
+
+        // WM_NORMAL_HINTS: flags, x, y, width, height, min width, min height, max width, max height, ...
+
+        const uint32_t sizeHintsFlags = (1 << 2) | (1 << 4) | (1 << 5); // PPosition | PMinSize | PMaxSize
+        uint32_t       sizeHints[18]  = {sizeHintsFlags, 0, 0, 0, 0, (uint32_t)width, (uint32_t)height, (uint32_t)width, (uint32_t)height};
+        ::xcb_change_property(connection_, XCB_PROP_MODE_REPLACE, window_, XCB_ATOM_WM_NORMAL_HINTS, XCB_ATOM_WM_SIZE_HINTS, 32, 18, sizeHints);
+
+        gc_ = ::xcb_generate_id(connection_);
+        ::xcb_create_gc(connection_, gc_, window_, 0, nullptr);
+
+        // collect the replies
+
+        xcb_intern_atom_reply_t* protocolsReply    = ::xcb_intern_atom_reply(connection_, protocolsCookie, nullptr);
+        xcb_intern_atom_reply_t* deleteWindowReply = ::xcb_intern_atom_reply(connection_, deleteWindowCookie, nullptr);
+
+        wmProtocols_    = protocolsReply ? protocolsReply->atom : (xcb_atom_t)XCB_ATOM_NONE;
+        wmDeleteWindow_ = deleteWindowReply ? deleteWindowReply->atom : (xcb_atom_t)XCB_ATOM_NONE;
+
+        free(protocolsReply);
+        free(deleteWindowReply);
+
+        const bool keyboardMapped = readKeyboardMapping(keyboardCookie);
+
+        if (::xcb_get_extension_data(connection_, &xcb_shm_id)->present)
+            attachShm(pitch_ * height);
+
+        if (wmProtocols_ == XCB_ATOM_NONE || wmDeleteWindow_ == XCB_ATOM_NONE || !keyboardMapped)
+        {
+            close();
+            return false;
+        }
+
+        ::xcb_change_property(connection_, XCB_PROP_MODE_REPLACE, window_, wmProtocols_, XCB_ATOM_ATOM, 32, 1, &wmDeleteWindow_);
+
+        // create (image) buffer when we could not get a shared memory segment
+
+        if (!shmData_)
+        {
+            buffer_.reset(pitch_ * height);
+            if (buffer_.isEmpty())
+            {
+                close();
+                return false;
+            }
+        }
+
+        // queried once: the largest request (in bytes) the server will accept
+
+        maximumRequestBytes_ = ::xcb_get_maximum_request_length(connection_) * 4;
+
+        // we have a winner!
+
+        ::xcb_map_window(connection_, window_);
+        ::xcb_flush(connection_);
+
+        if (DisplayAdapter::listener())
+            DisplayAdapter::listener()->onOpen(wrapper() ? *wrapper() : *(DisplayInterface*)this);
+
+        return true;
+    }
+
+    void close() override
+    {
+        if (connection_)
+        {
+            detachShm();
+
+            if (gc_)
+                ::xcb_free_gc(connection_, gc_);
+
+            if (window_)
+                ::xcb_destroy_window(connection_, window_);
+
+            ::xcb_disconnect(connection_);
+            connection_ = nullptr;
+        }
+
+        if (keySyms_)
+        {
+            free(keySyms_);
+            keySyms_ = nullptr;
+        }
+
+        DisplayAdapter::close(); // note: this calls our virtual defaults method
+    }
+
+    bool update(const TrueColorPixel* trueColorPixels, const FloatingPointPixel* floatingPointPixels, const Rectangle* dirtyBox) override
+    {
+        if (isShuttingDown_)
+        {
+            close();
+            return false;
+        }
+
+        if (!connection_ || !window_)
+            return false;
+
+        if (!trueColorPixels && !floatingPointPixels)
+            return false;
+
+        // the server must be done reading the segment before we overwrite it
+
+        if (!waitForShm())
+        {
+            close();
+            return false;
+        }
+
+        const int w = width();
+        const int h = height();
+
+        const bool shortcut = !shmData_ && trueColorPixels != nullptr && destFormat_ == Format::XRGB8888 && pitch_ == w * 4 && !swapBytes_;
+
+        char* pixels = shmData_ ? shmData_ : shortcut ? (char*)trueColorPixels : buffer_.get();
+
+        const int band = bandHeight() > 0 && bandHeight() < h ? bandHeight() : h;
+
+        for (int y = 0; y < h; y += band)
+        {
+            const int rows = y + band < h ? band : h - y;
+
+            if (!shortcut)
+                convert(trueColorPixels, floatingPointPixels, pixels, y, rows);
+
+            if (shmData_)
+            {
+                const bool lastBand = y + rows == h;
+
+                // note: the segment rows are pitch_ bytes apart, which the scanline pad may make wider than w pixels
+
+                xcb_void_cookie_t cookie = ::xcb_shm_put_image(connection_, window_, gc_, pitch_ / bytesPerPixel_, h, 0, y, w, rows, 0, y,
+                                                               depth_, XCB_IMAGE_FORMAT_Z_PIXMAP, lastBand, shmSegment_, 0);
+                trackRequest(cookie, y == 0);
+
+                if (lastBand)
+                    shmPending_ = true;
+            }
+            else
+            {
+                putImage(pixels + y * pitch_, y, rows, y == 0);
+            }
+        }
+
+        // one flush for all the image requests of the frame
+
+        ::xcb_flush(connection_);
+
+        pumpEvents();
+
+        if (imageFailed_)
+        {
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    bool waitEvents(double timeout) override
+    {
+        if (!connection_)
+            return false;
+
+        ::xcb_flush(connection_);
+
+        const double deadline = timeout < 0.0 ? -1.0 : monotonicTime() + timeout;
+
+        xcb_generic_event_t* event = nullptr;
+        while (!(event = ::xcb_poll_for_event(connection_)))
+        {
+            if (::xcb_connection_has_error(connection_) || !waitReadable(::xcb_get_file_descriptor(connection_), deadline))
+                return false;
+        }
+
+        handleEvent(event);
+        free(event);
+
+        pumpEvents();
+
+        if (isShuttingDown_)
+            close();
+
+        return true;
+    }
+
+    void title(const char title[]) override
+    {
+        DisplayAdapter::title(title);
+
+        if (connection_ && window_)
+        {
+            ::xcb_change_property(connection_, XCB_PROP_MODE_REPLACE, window_, XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, strlen(title), title);
+            ::xcb_flush(connection_);
+        }
+    }
+
+    Format format() const override
+    {
+        return destFormat_;
+    }
+
+    void quality(Quality quality) override
+    {
+        DisplayAdapter::quality(quality);
+
+        if (floatingPointConverter_)
+            selectFloatingPointConverter();
+    }
+
+    Quality quality() const override
+    {
+        return DisplayAdapter::quality();
+    }
+
+    static void* allocatePixels(integer64 bytes)
+    {
+        return allocatePixelMemory(bytes);
+    }
+
+    static void freePixels(void* pixels)
+    {
+        freePixelMemory(pixels);
+    }
+
+protected:
+    void defaults() override
+    {
+        DisplayAdapter::defaults();
+
+        connection_ = nullptr;
+        screen_     = nullptr;
+        window_     = 0;
+        gc_         = 0;
+        depth_      = 0;
+        buffer_.reset();
+        trueColorConverter_     = 0;
+        floatingPointConverter_ = 0;
+        swapBytes_              = false;
+        isShuttingDown_         = false;
+        destFormat_             = Format::Unknown;
+        bytesPerPixel_          = 0;
+        pitch_                  = 0;
+        maximumRequestBytes_    = 0;
+        wmProtocols_            = XCB_ATOM_NONE;
+        wmDeleteWindow_         = XCB_ATOM_NONE;
+        shmSegment_             = 0;
+        shmData_                = nullptr;
+        shmPending_             = false;
+        shmEvent_               = 0;
+        firstImageSequence_     = 0;
+        lastImageSequence_      = 0;
+        imageFailed_            = false;
+        keySyms_                = nullptr;
+        keySymsPerKeyCode_      = 0;
+        minKeyCode_             = 0;
+        keyCodeCount_           = 0;
+        keys_.reset();
+        motion_.reset();
+    }
+
+private:
+    enum
+    {
+        eventMask_ = XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_KEY_RELEASE | XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE | XCB_EVENT_MASK_POINTER_MOTION | XCB_EVENT_MASK_BUTTON_MOTION | XCB_EVENT_MASK_FOCUS_CHANGE
+    };
+
+    typedef DirtyVector<char> TBuffer;
+
+    static const xcb_visualtype_t* findVisual(const xcb_screen_t* screen, xcb_visualid_t id)
+    {
+        for (xcb_depth_iterator_t depths = ::xcb_screen_allowed_depths_iterator(screen); depths.rem; ::xcb_depth_next(&depths))
+        {
+            for (xcb_visualtype_iterator_t visuals = ::xcb_depth_visuals_iterator(depths.data); visuals.rem; ::xcb_visualtype_next(&visuals))
+            {
+                if (visuals.data->visual_id == id)
+                    return visuals.data;
+            }
+        }
+        return nullptr;
+    }
+
+    // open failed half way, pick up the replies so they don't linger in the connection
+
+    void discardReplies(xcb_intern_atom_cookie_t protocolsCookie, xcb_intern_atom_cookie_t deleteWindowCookie, xcb_get_keyboard_mapping_cookie_t keyboardCookie)
+    {
+        ::xcb_discard_reply(connection_, protocolsCookie.sequence);
+        ::xcb_discard_reply(connection_, deleteWindowCookie.sequence);
+        ::xcb_discard_reply(connection_, keyboardCookie.sequence);
+    }
+
+    bool readKeyboardMapping(xcb_get_keyboard_mapping_cookie_t cookie)
+    {
+        xcb_get_keyboard_mapping_reply_t* reply = ::xcb_get_keyboard_mapping_reply(connection_, cookie, nullptr);
+        if (!reply)
+            return false;
+
+        const int count = ::xcb_get_keyboard_mapping_keysyms_length(reply);
+
+        keySyms_ = static_cast<xcb_keysym_t*>(malloc(count * sizeof(xcb_keysym_t)));
+        if (keySyms_)
+        {
+            memcpy(keySyms_, ::xcb_get_keyboard_mapping_keysyms(reply), count * sizeof(xcb_keysym_t));
+            keySymsPerKeyCode_ = reply->keysyms_per_keycode;
+            minKeyCode_        = ::xcb_get_setup(connection_)->min_keycode;
+            keyCodeCount_      = keySymsPerKeyCode_ ? count / keySymsPerKeyCode_ : 0;
+        }
+
+        free(reply);
+        return keySyms_ != nullptr;
+    }
+
+    // equivalent of XkbKeycodeToKeysym( display, keyCode, 0, 0 )
+
+    xcb_keysym_t keySym(xcb_keycode_t keyCode) const
+    {
+        const int index = keyCode - minKeyCode_;
+        if (index < 0 || index >= keyCodeCount_)
+            return 0;
+        return keySyms_[index * keySymsPerKeyCode_];
+    }
+
+    void attachShm(int size)
+    {
+        const int id = ::shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+        if (id < 0)
+            return;
+
+        void* data = ::shmat(id, nullptr, 0);
+        if (data == (void*)-1)
+        {
+            ::shmctl(id, IPC_RMID, nullptr);
+            return;
+        }
+
+        // this is the one request we check synchronously: a remote server will refuse the segment
+
+        shmSegment_ = ::xcb_generate_id(connection_);
+
+        xcb_generic_error_t* error = ::xcb_request_check(connection_, ::xcb_shm_attach_checked(connection_, shmSegment_, id, 0));
+
+        // the segment goes away as soon as both of us have detached from it
+
+        ::shmctl(id, IPC_RMID, nullptr);
+
+        if (error)
+        {
+            free(error);
+            ::shmdt(data);
+            shmSegment_ = 0;
+            return;
+        }
+
+        shmData_  = static_cast<char*>(data);
+        shmEvent_ = ::xcb_get_extension_data(connection_, &xcb_shm_id)->first_event + XCB_SHM_COMPLETION;
+    }
+
+    void detachShm()
+    {
+        if (!shmData_)
+            return;
+
+        ::xcb_shm_detach(connection_, shmSegment_);
+        ::xcb_flush(connection_);
+        ::shmdt(shmData_);
+
+        shmData_    = nullptr;
+        shmSegment_ = 0;
+        shmPending_ = false;
+    }
+
+    bool waitForShm()
+    {
+        while (shmPending_)
+        {
+            xcb_generic_event_t* event = ::xcb_wait_for_event(connection_);
+            if (!event)
+                return false;
+
+            handleEvent(event);
+            free(event);
+        }
+        return true;
+    }
+
+    // pick the converter for floating point pixels by the requested quality, swapping bytes for the server if need be
+
+    bool selectFloatingPointConverter()
+    {
+        floatingPointConverter_ = requestConverter(Format::XBGRFFFF, destFormat_);
+
+        if (quality() == Quality::Fast && fastFloatingPoint_.select(destFormat_))
+            floatingPointConverter_ = &fastFloatingPoint_;
+
+        if (floatingPointConverter_ && swapBytes_)
+        {
+            swappedFloatingPoint_.select(floatingPointConverter_, sizeof(FloatingPointPixel), bytesPerPixel_);
+            floatingPointConverter_ = &swappedFloatingPoint_;
+        }
+
+        return floatingPointConverter_ != nullptr;
+    }
+
+    void convert(const TrueColorPixel* trueColorPixels, const FloatingPointPixel* floatingPointPixels, char* pixels, int y, int rows)
+    {
+        const int w = width();
+
+        if (pitch_ == w * bytesPerPixel_)
+        {
+            if (trueColorPixels)
+                trueColorConverter_->convert(trueColorPixels + y * w, pixels + y * pitch_, w * rows);
+            else
+                floatingPointConverter_->convert(floatingPointPixels + y * w, pixels + y * pitch_, w * rows);
+            return;
+        }
+
+        // padded scanlines, convert a row at a time
+
+        for (int row = y; row < y + rows; ++row)
+        {
+            if (trueColorPixels)
+                trueColorConverter_->convert(trueColorPixels + row * w, pixels + row * pitch_, w);
+            else
+                floatingPointConverter_->convert(floatingPointPixels + row * w, pixels + row * pitch_, w);
+        }
+    }
+
+    // send rows through the socket, split into as few requests as the server allows
+
+    void putImage(const char* pixels, int y, int rows, bool firstRequest)
+    {
+        const int headerBytes    = 24;
+        int       rowsPerRequest = (maximumRequestBytes_ - headerBytes) / pitch_;
+        if (rowsPerRequest < 1)
+            rowsPerRequest = 1;
+
+        for (int row = 0; row < rows; row += rowsPerRequest)
+        {
+            const int count = row + rowsPerRequest < rows ? rowsPerRequest : rows - row;
+
+            xcb_void_cookie_t cookie = ::xcb_put_image(connection_, XCB_IMAGE_FORMAT_Z_PIXMAP, window_, gc_, width(), count, 0, y + row,
+                                                       0, depth_, count * pitch_, (const uint8_t*)pixels + row * pitch_);
+            trackRequest(cookie, firstRequest && row == 0);
+        }
+    }
+
+    // remember the sequence numbers of this frame's image requests so their errors can be recognized later
+
+    void trackRequest(xcb_void_cookie_t cookie, bool firstRequest)
+    {
+        if (firstRequest)
+            firstImageSequence_ = cookie.sequence;
+        lastImageSequence_ = cookie.sequence;
+    }
+
+    void handleError(const xcb_generic_error_t* error)
+    {
+        if (error->full_sequence - firstImageSequence_ > lastImageSequence_ - firstImageSequence_)
+            return;
+
+        if (shmData_)
+        {
+            // the server gave up on our segment, fall back to sending pixels through the socket
+
+            detachShm();
+            buffer_.reset(pitch_ * height());
+            imageFailed_ = buffer_.isEmpty();
+        }
+        else
+        {
+            imageFailed_ = true;
+        }
+    }
+
+    void pumpEvents()
+    {
+        while (xcb_generic_event_t* event = ::xcb_poll_for_event(connection_))
+        {
+            handleEvent(event);
+            free(event);
+        }
+
+        motion_.flush(listener(), wrapper() ? *wrapper() : *(DisplayInterface*)this);
+
+        // send key press and up events
+
+        keys_.send(listener(), wrapper() ? *wrapper() : *(DisplayInterface*)this);
+    }
+
+    void handleEvent(const xcb_generic_event_t* event)
+    {
+        const int type = event->response_type & ~0x80;
+
+        if (type == 0)
+        {
+            handleError(reinterpret_cast<const xcb_generic_error_t*>(event));
+            return;
+        }
+
+        if (shmData_ && type == shmEvent_)
+        {
+            shmPending_ = false;
+            return;
+        }
+
+        // keep mouse moves in order with the other input events
+
+        if (type != XCB_MOTION_NOTIFY)
+            motion_.flush(listener(), wrapper() ? *wrapper() : *(DisplayInterface*)this);
+
+        switch (type)
+        {
+            case XCB_KEY_PRESS:
+            case XCB_KEY_RELEASE:
+            {
+                const xcb_key_press_event_t* keyEvent = reinterpret_cast<const xcb_key_press_event_t*>(event);
+
+                const Key key = UnixKeyMap::translate(keySym(keyEvent->detail));
+
+                if (type == XCB_KEY_PRESS)
+                {
+                    if (keys_.press(key))
+                    {
+                        queueEvent(Event::KeyDown, monotonicTime(), key, nullptr, false);
+
+                        bool defaultKeyHandlers = true;
+
+                        if (listener())
+                        {
+                            listener()->onKeyDown(wrapper() ? *wrapper() : *(DisplayInterface*)this, key);
+                            defaultKeyHandlers = listener()->defaultKeyHandlers();
+                        }
+
+                        if (defaultKeyHandlers && key == Key::Escape)
+                        {
+                            isShuttingDown_ = true;
+                        }
+                    }
+                }
+                else
+                {
+                    if (keys_.release(key))
+                        queueEvent(Event::KeyUp, monotonicTime(), key, nullptr, false);
+                }
+                break;
+            }
+
+            case XCB_BUTTON_PRESS:
+            case XCB_BUTTON_RELEASE:
+            {
+                const xcb_button_press_event_t* buttonEvent = reinterpret_cast<const xcb_button_press_event_t*>(event);
+
+                Mouse mouse;
+                mouse.x              = static_cast<float>(buttonEvent->event_x);
+                mouse.y              = static_cast<float>(buttonEvent->event_y);
+                mouse.buttons.left   = buttonEvent->detail == XCB_BUTTON_INDEX_1;
+                mouse.buttons.middle = buttonEvent->detail == XCB_BUTTON_INDEX_2;
+                mouse.buttons.right  = buttonEvent->detail == XCB_BUTTON_INDEX_3;
+                queueEvent(type == XCB_BUTTON_PRESS ? Event::MouseButtonDown : Event::MouseButtonUp, monotonicTime(), Key(), &mouse, false);
+                if (type == XCB_BUTTON_PRESS)
+                {
+                    if (listener())
+                        listener()->onMouseButtonDown(wrapper() ? *wrapper() : *(DisplayInterface*)this, mouse);
+                }
+                else
+                {
+                    if (listener())
+                        listener()->onMouseButtonUp(wrapper() ? *wrapper() : *(DisplayInterface*)this, mouse);
+                }
+                break;
+            }
+
+            case XCB_MOTION_NOTIFY:
+            {
+                const xcb_motion_notify_event_t* motionEvent = reinterpret_cast<const xcb_motion_notify_event_t*>(event);
+
+                Mouse mouse;
+                mouse.x              = static_cast<float>(motionEvent->event_x);
+                mouse.y              = static_cast<float>(motionEvent->event_y);
+                mouse.buttons.left   = (motionEvent->state & XCB_BUTTON_MASK_1) != 0;
+                mouse.buttons.middle = (motionEvent->state & XCB_BUTTON_MASK_2) != 0;
+                mouse.buttons.right  = (motionEvent->state & XCB_BUTTON_MASK_3) != 0;
+                queueEvent(Event::MouseMove, monotonicTime(), Key(), &mouse, false);
+                if (coalesceMouseMotion())
+                    motion_.add(listener(), wrapper() ? *wrapper() : *(DisplayInterface*)this, mouse);
+                else if (listener())
+                    listener()->onMouseMove(wrapper() ? *wrapper() : *(DisplayInterface*)this, mouse);
+                break;
+            }
+
+            case XCB_FOCUS_IN:
+            case XCB_FOCUS_OUT:
+            {
+                const xcb_focus_in_event_t* focusEvent = reinterpret_cast<const xcb_focus_in_event_t*>(event);
+
+                // note: focus moving between our window and its children is no change for the user
+
+                if (focusEvent->detail == XCB_NOTIFY_DETAIL_INFERIOR)
+                    break;
+
+                // keys held when we lose focus never see their key releases, so let go of them now
+
+                const bool active = type == XCB_FOCUS_IN;
+
+                if (!active)
+                {
+                    Key       released[256];
+                    const int count = keys_.releaseAll(released);
+
+                    for (int i = 0; i < count; ++i)
+                        queueEvent(Event::KeyUp, monotonicTime(), released[i], nullptr, false);
+                }
+
+                queueEvent(Event::Activate, monotonicTime(), Key(), nullptr, active);
+                if (listener())
+                    listener()->onActivate(wrapper() ? *wrapper() : *(DisplayInterface*)this, active);
+                break;
+            }
+
+            case XCB_CLIENT_MESSAGE:
+            {
+                const xcb_client_message_event_t* clientEvent = reinterpret_cast<const xcb_client_message_event_t*>(event);
+
+                if (clientEvent->type == wmProtocols_ &&
+                    clientEvent->format == 32 &&
+                    clientEvent->data.data32[0] == wmDeleteWindow_)
+                {
+                    queueEvent(Event::Close, monotonicTime(), Key(), nullptr, false);
+
+                    if (listener())
+                    {
+                        if (listener()->onClose(wrapper() ? *wrapper() : *(DisplayInterface*)this))
+                            isShuttingDown_ = true;
+                    }
+                    else
+                    {
+                        isShuttingDown_ = true;
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    xcb_connection_t* connection_;
+    xcb_screen_t*     screen_;
+    xcb_window_t      window_;
+    xcb_gcontext_t    gc_;
+    int               depth_;
+    TBuffer           buffer_;
+    Converter*        trueColorConverter_;
+    Converter*        floatingPointConverter_;
+    Converter_Swapped swappedTrueColor_; // the converters swapping bytes for a server with the other byte order
+    Converter_Swapped swappedFloatingPoint_;
+    Converter_Fast    fastFloatingPoint_; // converts floating point pixels with Quality::Fast
+    bool              swapBytes_;
+    bool              isShuttingDown_;
+    Format            destFormat_;
+    int               bytesPerPixel_;
+    int               pitch_;
+    int               maximumRequestBytes_;
+    xcb_atom_t        wmProtocols_;
+    xcb_atom_t        wmDeleteWindow_;
+    xcb_shm_seg_t     shmSegment_;
+    char*             shmData_;
+    bool              shmPending_;
+    int               shmEvent_;
+    unsigned int      firstImageSequence_;
+    unsigned int      lastImageSequence_;
+    bool              imageFailed_;
+    xcb_keysym_t*     keySyms_;
+    int               keySymsPerKeyCode_;
+    int               minKeyCode_;
+    int               keyCodeCount_;
+    UnixKeyState      keys_;
+    MouseMotionBuffer motion_;
+};
+} // namespace PixelToaster
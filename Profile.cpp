@@ -6,6 +6,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#ifdef __linux__
+#    include <string.h>
+#    include <unistd.h>
+#    include <sys/ioctl.h>
+#    include <sys/syscall.h>
+#    include <linux/perf_event.h>
+#endif
+
 using namespace PixelToaster;
 
 const char* getFormatString(Format format)
@@ -21,6 +29,13 @@ const char* getFormatString(Format format)
         case Format::XRGB1555: return "xrgb1555";
         case Format::XBGR1555: return "xbgr1555";
         case Format::XBGRFFFF: return "floating point";
+        case Format::ARGB8888: return "argb8888";
+        case Format::XRGB2101010: return "xrgb2101010";
+        case Format::XBGR2101010: return "xbgr2101010";
+        case Format::Indexed8: return "indexed8";
+        case Format::I420: return "i420";
+        case Format::NV12: return "nv12";
+        case Format::YUY2: return "yuy2";
         default: return "???";
     }
 }
@@ -85,6 +100,359 @@ void profileIntegerConverter(Format format, const integer32* source, void* desti
     printf(" = %f ms\n", (double)time / iterations * 1000);
 }
 
+void profileDisplayUpdate(Display& display, const Pixel* source, int bandHeight)
+{
+    if (bandHeight > 0)
+        printf("   floating point update, %d row bands", bandHeight);
+    else
+        printf("   floating point update, whole frame");
+
+    display.bandHeight(bandHeight);
+
+    double startTime = timer.time();
+
+    double time = 0.0;
+
+    int iterations = 0;
+
+    while (time < duration)
+    {
+        if (!display.update(source))
+        {
+            printf("\n     failed: display update\n");
+            exit(1);
+        }
+        time = timer.time() - startTime;
+        iterations++;
+    }
+
+    printf(" = %f ms\n", (double)time / iterations * 1000);
+}
+
+void profileDisplayQualityUpdate(Display& display, const Pixel* source)
+{
+    printf("   floating point update, fast quality");
+
+    display.bandHeight(0);
+    display.quality(Quality::Fast);
+
+    double startTime = timer.time();
+
+    double time = 0.0;
+
+    int iterations = 0;
+
+    while (time < duration)
+    {
+        if (!display.update(source))
+        {
+            printf("\n     failed: display update\n");
+            exit(1);
+        }
+        time = timer.time() - startTime;
+        iterations++;
+    }
+
+    display.quality(Quality::Exact);
+
+    printf(" = %f ms\n", (double)time / iterations * 1000);
+}
+
+void profileDisplayFormatUpdate(Display& display, Format format, const void* source)
+{
+    printf("   %s update", getFormatString(format));
+
+    double startTime = timer.time();
+
+    double time = 0.0;
+
+    int iterations = 0;
+
+    while (time < duration)
+    {
+        if (!display.update(source, format))
+        {
+            printf("\n     failed: display update\n");
+            exit(1);
+        }
+        time = timer.time() - startTime;
+        iterations++;
+    }
+
+    printf(" = %f ms\n", (double)time / iterations * 1000);
+}
+
+void profileDisplayPaletteUpdate(Display& display, const integer8* source)
+{
+    printf("   indexed8 update, palette cycling");
+
+    TrueColorPixel palette[256];
+
+    double startTime = timer.time();
+
+    double time = 0.0;
+
+    int iterations = 0;
+
+    while (time < duration)
+    {
+        for (int i = 0; i < 256; ++i)
+            palette[i] = TrueColorPixel(integer8(i + iterations), integer8(i), integer8(255 - i), 255);
+
+        display.palette(palette);
+
+        if (!display.update(source))
+        {
+            printf("\n     failed: display update\n");
+            exit(1);
+        }
+        time = timer.time() - startTime;
+        iterations++;
+    }
+
+    printf(" = %f ms\n", (double)time / iterations * 1000);
+}
+
+void profileDisplayViewportUpdate(Display& display, Format format, const void* canvas, int pitch, int x, int y)
+{
+    printf("   %s viewport update", getFormatString(format));
+
+    double startTime = timer.time();
+
+    double time = 0.0;
+
+    int iterations = 0;
+
+    while (time < duration)
+    {
+        if (!display.update(canvas, format, pitch, x, y))
+        {
+            printf("\n     failed: display update\n");
+            exit(1);
+        }
+        time = timer.time() - startTime;
+        iterations++;
+    }
+
+    printf(" = %f ms\n", (double)time / iterations * 1000);
+}
+
+void profileDisplayScroll(Display& display, Format format, const void* source, int dy)
+{
+    printf("   %s scroll by %d", getFormatString(format), dy);
+
+    double startTime = timer.time();
+
+    double time = 0.0;
+
+    int iterations = 0;
+
+    while (time < duration)
+    {
+        if (!display.scroll(0, dy, source, format))
+        {
+            printf("\n     failed: display scroll\n");
+            exit(1);
+        }
+        time = timer.time() - startTime;
+        iterations++;
+    }
+
+    printf(" = %f ms\n", (double)time / iterations * 1000);
+}
+
+// updates a frame where a few pixels change each time, like a remote view of a mostly static desktop
+
+void profileDisplayTransport(Display& display, Transport transport, int bytesPerSecond, vector<integer32>& frame)
+{
+    printf("   %s transport, budget %d bytes per second", transport == Transport::Remote ? "remote" : "local", bytesPerSecond);
+
+    display.transport(transport);
+    display.bandwidth(bytesPerSecond);
+
+    double startTime = timer.time();
+
+    double time = 0.0;
+
+    int iterations = 0;
+
+    while (time < duration)
+    {
+        frame[(iterations * 7919) % frame.size()] = iterations;
+
+        if (!display.update(&frame[0], Format::XRGB8888))
+        {
+            printf("\n     failed: display update\n");
+            exit(1);
+        }
+        time = timer.time() - startTime;
+        iterations++;
+    }
+
+    display.transport(Transport::Automatic);
+    display.bandwidth(0);
+
+    printf(" = %f ms\n", (double)time / iterations * 1000);
+}
+
+// counts the data tlb misses of this process, where the system lets us
+
+class TlbMissCounter
+{
+public:
+    TlbMissCounter()
+    {
+        fd = -1;
+
+#ifdef __linux__
+        perf_event_attr attributes;
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.size           = sizeof(attributes);
+        attributes.type           = PERF_TYPE_HW_CACHE;
+        attributes.config         = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attributes.disabled       = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv     = 1;
+
+        fd = (int)syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0);
+#endif
+    }
+
+    ~TlbMissCounter()
+    {
+#ifdef __linux__
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+
+    bool available() const
+    {
+        return fd >= 0;
+    }
+
+    void start()
+    {
+#ifdef __linux__
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    double stop()
+    {
+        long long count = 0;
+
+#ifdef __linux__
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) != sizeof(count))
+            count = 0;
+#endif
+
+        return (double)count;
+    }
+
+private:
+    int fd;
+};
+
+void profileFrameMemory(const char name[], const Pixel* source, integer32* destination, int count)
+{
+    printf("   floating point -> truecolor, %s", name);
+
+    Converter* converter = requestConverter(Format::XBGRFFFF, Format::XRGB8888);
+
+    TlbMissCounter misses;
+
+    if (misses.available())
+        misses.start();
+
+    double startTime = timer.time();
+
+    double time = 0.0;
+
+    int iterations = 0;
+
+    while (time < duration)
+    {
+        converter->convert(source, destination, count);
+        time = timer.time() - startTime;
+        iterations++;
+    }
+
+    if (misses.available())
+        printf(" = %f ms, %.0f tlb misses\n", (double)time / iterations * 1000, misses.stop() / iterations);
+    else
+        printf(" = %f ms\n", (double)time / iterations * 1000);
+}
+
+bool profileDisplayOpen(int count)
+{
+    printf("   open and close %d displays", count);
+
+    Display* displays = new Display[count];
+
+    double startTime = timer.time();
+
+    double time = 0.0;
+
+    int iterations = 0;
+
+    while (time < duration)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            if (!displays[i].open("Profile", 320, 240, Output::Windowed, Mode::FloatingPoint))
+            {
+                printf("\n     skipped: could not open display\n");
+                delete[] displays;
+                return false;
+            }
+        }
+
+        for (int i = 0; i < count; ++i)
+            displays[i].close();
+
+        time = timer.time() - startTime;
+        iterations++;
+    }
+
+    printf(" = %f ms\n", (double)time / iterations * 1000);
+
+    delete[] displays;
+    return true;
+}
+
+void profileDisplayReopen()
+{
+    printf("   reopen display between two sizes");
+
+    Display display;
+
+    if (!display.open("Profile", 320, 240, Output::Windowed, Mode::FloatingPoint))
+    {
+        printf("\n     skipped: could not open display\n");
+        return;
+    }
+
+    double startTime = timer.time();
+
+    double time = 0.0;
+
+    int iterations = 0;
+
+    while (time < duration)
+    {
+        display.open("Profile", 640, 480, Output::Windowed, Mode::FloatingPoint);
+        display.open("Profile", 320, 240, Output::Windowed, Mode::FloatingPoint);
+
+        time = timer.time() - startTime;
+        iterations += 2;
+    }
+
+    printf(" = %f ms\n", (double)time / iterations * 1000);
+}
+
 int main()
 {
     const int width  = 256;
@@ -120,6 +488,9 @@ int main()
     profilePixelConverter(Format::BGR565, &pixelSource[0], destination, (int)pixelSource.size());
     profilePixelConverter(Format::XRGB1555, &pixelSource[0], destination, (int)pixelSource.size());
     profilePixelConverter(Format::XBGR1555, &pixelSource[0], destination, (int)pixelSource.size());
+    profilePixelConverter(Format::ARGB8888, &pixelSource[0], destination, (int)pixelSource.size());
+    profilePixelConverter(Format::XRGB2101010, &pixelSource[0], destination, (int)pixelSource.size());
+    profilePixelConverter(Format::XBGR2101010, &pixelSource[0], destination, (int)pixelSource.size());
 
     printf("\ntruecolor conversion routines:\n\n");
 
@@ -132,6 +503,99 @@ int main()
     profileIntegerConverter(Format::BGR565, &integerSource[0], destination, (int)integerSource.size());
     profileIntegerConverter(Format::XRGB1555, &integerSource[0], destination, (int)integerSource.size());
     profileIntegerConverter(Format::XBGR1555, &integerSource[0], destination, (int)integerSource.size());
+    profileIntegerConverter(Format::ARGB8888, &integerSource[0], destination, (int)integerSource.size());
+    profileIntegerConverter(Format::XRGB2101010, &integerSource[0], destination, (int)integerSource.size());
+    profileIntegerConverter(Format::XBGR2101010, &integerSource[0], destination, (int)integerSource.size());
+
+    printf("\nframe memory:\n\n");
+
+    {
+        const int frameSize = 1920 * 1080;
+
+        vector<Pixel>     vectorSource(frameSize, pixelSource[0]);
+        vector<integer32> vectorDestination(frameSize);
+
+        profileFrameMemory("vector", &vectorSource[0], &vectorDestination[0], frameSize);
+
+        FrameBuffer<Pixel>     frameSource(frameSize);
+        FrameBuffer<integer32> frameDestination(frameSize);
+
+        for (int i = 0; i < frameSize; ++i)
+            frameSource[i] = pixelSource[0];
+
+        profileFrameMemory("frame buffer", frameSource.data(), frameDestination.data(), frameSize);
+    }
+
+    printf("\ndisplay update routines:\n\n");
+
+    const int displayWidth  = 1024;
+    const int displayHeight = 768;
+
+    vector<Pixel> displaySource(displayWidth * displayHeight, pixelSource[0]);
+
+    Display display;
+
+    if (display.open("Profile", displayWidth, displayHeight, Output::Windowed, Mode::FloatingPoint))
+    {
+        profileDisplayUpdate(display, &displaySource[0], 0);
+        profileDisplayUpdate(display, &displaySource[0], 16);
+        profileDisplayUpdate(display, &displaySource[0], 32);
+        profileDisplayUpdate(display, &displaySource[0], 64);
+        profileDisplayUpdate(display, &displaySource[0], 128);
+        profileDisplayUpdate(display, &displaySource[0], 256);
+        profileDisplayQualityUpdate(display, &displaySource[0]);
+
+        // note: big enough for a frame in any integer format
+
+        vector<integer32> formatSource(displayWidth * displayHeight, integerSource[0]);
+
+        display.bandHeight(0);
+
+        profileDisplayFormatUpdate(display, Format::XRGB8888, &formatSource[0]);
+        profileDisplayFormatUpdate(display, Format::RGB565, &formatSource[0]);
+        if (display.format() != Format::XRGB8888 && display.format() != Format::RGB565)
+            profileDisplayFormatUpdate(display, display.format(), &formatSource[0]);
+
+        profileDisplayFormatUpdate(display, Format::Indexed8, &formatSource[0]);
+        profileDisplayPaletteUpdate(display, (const integer8*)&formatSource[0]);
+
+        profileDisplayFormatUpdate(display, Format::I420, &formatSource[0]);
+        profileDisplayFormatUpdate(display, Format::NV12, &formatSource[0]);
+        profileDisplayFormatUpdate(display, Format::YUY2, &formatSource[0]);
+
+        // a viewport in the middle of a canvas twice the size of the display each way
+
+        vector<integer32> canvas(displayWidth * 2 * displayHeight * 2, integerSource[0]);
+
+        const int canvasPitch = displayWidth * 2 * sizeof(integer32);
+
+        profileDisplayViewportUpdate(display, Format::XRGB8888, &canvas[0], canvasPitch, displayWidth / 2, displayHeight / 2);
+        profileDisplayViewportUpdate(display, Format::XBGR8888, &canvas[0], canvasPitch, displayWidth / 2, displayHeight / 2);
+
+        display.update(&formatSource[0], Format::XBGR8888);
+
+        profileDisplayScroll(display, Format::XBGR8888, &formatSource[0], -1);
+        profileDisplayScroll(display, Format::XBGR8888, &formatSource[0], -16);
+
+        profileDisplayTransport(display, Transport::Local, 0, formatSource);
+        profileDisplayTransport(display, Transport::Remote, 0, formatSource);
+        profileDisplayTransport(display, Transport::Remote, 1000000, formatSource);
+
+        display.close();
+    }
+    else
+    {
+        printf("   skipped: could not open display\n");
+    }
+
+    printf("\ndisplay open routines:\n\n");
+
+    if (profileDisplayOpen(1))
+    {
+        profileDisplayOpen(4);
+        profileDisplayOpen(16);
+        profileDisplayReopen();
+    }
 
     printf("\n");
 }
@@ -4,10 +4,17 @@
 	Part of the PixelToaster Framebuffer Library - http://www.pixeltoaster.com
 */
 
+#include <cassert>
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include "PixelToaster.h"
 #include "PixelToasterConversion.h"
+#include "PixelToasterCommon.h"
+
+#if PIXELTOASTER_PLATFORM == PIXELTOASTER_UNIX
+#    include "PixelToasterUnix.h"
+#endif
 
 using namespace PixelToaster;
 
@@ -20,6 +27,44 @@ bool equal(float a, float b)
     return difference > epsilon || difference < epsilon;
 }
 
+// check the converter from a format to truecolor against the conversion routine it should use.
+// the source pixel bytes are just the bytes of the loop counter, which covers every pixel value.
+
+template <typename T>
+void test_converter_to_truecolor(const char name[], Format format, void (*reference)(const T[], integer32[], unsigned int), unsigned int count)
+{
+    printf("   %s -> truecolor\n", name);
+
+    Converter* converter = requestConverter(format, Format::XRGB8888);
+
+    if (!converter)
+    {
+        printf("     failed: invalid converter\n");
+        exit(1);
+    }
+
+    converter->begin();
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        integer32 a = i;
+        integer32 b;
+        integer32 c;
+
+        converter->convert(&a, &b, 1);
+
+        reference((const T*)&a, &c, 1);
+
+        if (b != c)
+        {
+            printf("     failed: %d vs. %d\n", b, c);
+            exit(1);
+        }
+    }
+
+    converter->end();
+}
+
 void test_converter_objects()
 {
     printf("testing converter objects:\n\n");
@@ -615,6 +660,16 @@ void test_converter_objects()
         converter->end();
     }
 
+    test_converter_to_truecolor("xbgr8888", Format::XBGR8888, convert_XBGR8888_to_XRGB8888, 0x01000000);
+    test_converter_to_truecolor("rgb888", Format::RGB888, convert_RGB888_to_XRGB8888, 0x01000000);
+    test_converter_to_truecolor("bgr888", Format::BGR888, convert_BGR888_to_XRGB8888, 0x01000000);
+    test_converter_to_truecolor("rgb565", Format::RGB565, convert_RGB565_to_XRGB8888, 0x00010000);
+    test_converter_to_truecolor("bgr565", Format::BGR565, convert_BGR565_to_XRGB8888, 0x00010000);
+    test_converter_to_truecolor("xrgb1555", Format::XRGB1555, convert_XRGB1555_to_XRGB8888, 0x00010000);
+    test_converter_to_truecolor("xbgr1555", Format::XBGR1555, convert_XBGR1555_to_XRGB8888, 0x00010000);
+    test_converter_to_truecolor("xrgb2101010", Format::XRGB2101010, convert_XRGB2101010_to_XRGB8888, 0x01000000);
+    test_converter_to_truecolor("xbgr2101010", Format::XBGR2101010, convert_XBGR2101010_to_XRGB8888, 0x01000000);
+
     printf("\n");
 }
 
@@ -2011,6 +2066,37 @@ void test_truecolor_to_xbgr8888()
     printf("     passed.\n\n");
 }
 
+void test_clamped_fraction()
+{
+    printf("   floating point -> 8 bit component\n");
+
+    printf("     checking known values...\n");
+
+    // the sse2 version used to turn values below 2^-24 into 255 and round values just under a step one step down
+
+    const float     values[10]   = {0.0f, 1.0e-30f, -1.0f, 0.0039061904f, 0.00781246042f, 0.128906235f, 0.5f, 0.68749994f, 1.0f, 2.0f};
+    const integer32 expected[10] = {0, 0, 0, 1, 2, 33, 128, 176, 255, 255};
+
+    for (int i = 0; i < 10; ++i)
+    {
+        const integer32 single = clamped_fraction_8(values[i]) >> 15;
+
+        integer32 block = single;
+
+#ifdef PIXELTOASTER_USE_SSE2
+        block = (integer32)_mm_cvtsi128_si32(clamped_fraction_8(_mm_set1_ps(values[i]))) >> 15;
+#endif
+
+        if (single != expected[i] || block != expected[i])
+        {
+            printf("     failed: %.9g -> %d and %d, expected %d\n", values[i], single, block, expected[i]);
+            exit(1);
+        }
+    }
+
+    printf("     passed.\n\n");
+}
+
 void test_floating_point_to_xrgb8888()
 {
     printf("   floating point -> xrgb8888\n");
@@ -3773,30 +3859,1727 @@ void test_floating_point_to_xbgr1555()
     printf("     passed.\n\n");
 }
 
-void test_conversion()
+void test_truecolor_to_argb8888()
 {
-    printf("testing pixel format conversion:\n\n");
+    printf("   truecolor -> argb8888\n");
 
-    test_truecolor_to_truecolor();
-    test_truecolor_to_xbgr1555();
-    test_truecolor_to_xrgb1555();
-    test_truecolor_to_bgr565();
-    test_truecolor_to_rgb565();
-    test_truecolor_to_bgr888();
-    test_truecolor_to_rgb888();
-    test_truecolor_to_xbgr8888();
+    printf("     checking every color and alpha...\n");
 
-    test_floating_point_to_xrgb8888();
-    test_floating_point_to_xbgr8888();
-    test_floating_point_to_rgb888();
-    test_floating_point_to_bgr888();
-    test_floating_point_to_rgb565();
-    test_floating_point_to_bgr565();
-    test_floating_point_to_xrgb1555();
-    test_floating_point_to_xbgr1555();
+    // one pixel for each pair of color and alpha, converted in one go so whole blocks take the vector path
+
+    integer32* source      = new integer32[0x10000];
+    integer32* destination = new integer32[0x10000];
+
+    for (unsigned int i = 0; i < 0x10000; ++i)
+    {
+        const integer32 color = i & 0xFF;
+        const integer32 alpha = i >> 8;
+        source[i]             = (alpha << 24) | (color << 16) | ((255 - color) << 8) | color;
+    }
+
+    convert_XRGB8888_to_ARGB8888(source, destination, 0x10000);
+
+    for (unsigned int i = 0; i < 0x10000; ++i)
+    {
+        const integer32 color = i & 0xFF;
+        const integer32 alpha = i >> 8;
+        const integer32 r     = (2 * color * alpha + 255) / 510;
+        const integer32 g     = (2 * (255 - color) * alpha + 255) / 510;
+
+        if (destination[i] != ((alpha << 24) | (r << 16) | (g << 8) | r))
+        {
+            printf("     failed: %x -> %x\n", source[i], destination[i]);
+            exit(1);
+        }
+    }
+
+    delete[] source;
+    delete[] destination;
+
+    printf("     checking opaque...\n");
+
+    integer32 input = 0x00123456;
+    integer32 output;
+
+    convert_XRGB8888_to_opaque_ARGB8888(&input, &output, 1);
+
+    if (output != 0xFF123456)
+    {
+        printf("     opaque test failed: %x\n", output);
+        exit(1);
+    }
+
+    printf("     passed.\n\n");
 }
 
-// ----------------------------------------------------------------------------------------
+void test_floating_point_to_argb8888()
+{
+    printf("   floating point -> argb8888\n");
+
+    printf("     checking premultiplied values...\n");
+
+    Pixel pixels[4] = {Pixel(1.0f, 1.0f, 1.0f, 1.0f), Pixel(1.0f, 0.5f, 0.0f, 0.5f), Pixel(2.0f, -1.0f, 0.5f, 1.5f), Pixel(1.0f, 1.0f, 1.0f, 0.0f)};
+
+    const integer32 expected[4] = {0xFFFFFFFF, 0x80804000, 0xFFFF0080, 0x00000000};
+
+    integer32 values[4];
+
+    convert_XBGRFFFF_to_ARGB8888(pixels, values, 4);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        if (values[i] != expected[i])
+        {
+            printf("     failed: (%f,%f,%f,%f) -> %x, expected %x\n", pixels[i].r, pixels[i].g, pixels[i].b, pixels[i].a, values[i], expected[i]);
+            exit(1);
+        }
+    }
+
+    printf("     checking blocks against single pixels...\n");
+
+    // note: an odd count, so the last pixels are converted one at a time either way
+
+    const unsigned int count = 4099;
+
+    Pixel*     source = new Pixel[count];
+    integer32* blocks = new integer32[count];
+
+    for (unsigned int i = 0; i < count; ++i)
+        source[i] = Pixel((i % 37) / 32.0f - 0.1f, (i % 101) / 100.0f, (i % 13) / 12.0f, (i % 29) / 25.0f - 0.1f);
+
+    convert_XBGRFFFF_to_ARGB8888(source, blocks, count);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        integer32 single;
+
+        convert_XBGRFFFF_to_ARGB8888(&source[i], &single, 1);
+
+        if (blocks[i] != single)
+        {
+            printf("     failed: (%f,%f,%f,%f) -> %x vs. %x\n", source[i].r, source[i].g, source[i].b, source[i].a, blocks[i], single);
+            exit(1);
+        }
+    }
+
+    delete[] source;
+    delete[] blocks;
+
+    printf("     passed.\n\n");
+}
+
+void test_truecolor_to_2101010()
+{
+    printf("   truecolor -> xrgb2101010 and xbgr2101010\n");
+
+    printf("     checking one-to-one...\n");
+
+    for (unsigned int i = 0; i <= 0x00FFFFFF; i++)
+    {
+        integer32 a = i;
+        integer32 b;
+        integer32 c;
+
+        convert_XRGB8888_to_XRGB2101010(&a, &b, 1);
+        convert_XRGB2101010_to_XRGB8888(&b, &c, 1);
+
+        if (a != c)
+        {
+            printf("     failed: %x -> %x -> %x\n", a, b, c);
+            exit(1);
+        }
+
+        convert_XRGB8888_to_XBGR2101010(&a, &b, 1);
+        convert_XBGR2101010_to_XRGB8888(&b, &c, 1);
+
+        if (a != c)
+        {
+            printf("     failed: %x -> %x -> %x\n", a, b, c);
+            exit(1);
+        }
+    }
+
+    printf("     checking full intensity\n");
+
+    integer32 input = 0x00FF0080;
+    integer32 output;
+
+    convert_XRGB8888_to_XRGB2101010(&input, &output, 1);
+
+    if (output != 0x3FF00202)
+    {
+        printf("     xrgb2101010 test failed: %x\n", output);
+        exit(1);
+    }
+
+    convert_XRGB8888_to_XBGR2101010(&input, &output, 1);
+
+    if (output != 0x202003FF)
+    {
+        printf("     xbgr2101010 test failed: %x\n", output);
+        exit(1);
+    }
+
+    printf("     passed.\n\n");
+}
+
+void test_floating_point_to_2101010()
+{
+    printf("   floating point -> xrgb2101010 and xbgr2101010\n");
+
+    printf("     checking known values...\n");
+
+    Pixel pixels[4] = {Pixel(1.0f, 0.0f, 0.0f), Pixel(0.0f, 1.0f, 0.0f), Pixel(0.0f, 0.0f, 1.0f), Pixel(0.5f, 2.0f, -1.0f)};
+
+    const integer32 expectedRGB[4] = {0x3FF00000, 0x000FFC00, 0x000003FF, 0x200FFC00};
+    const integer32 expectedBGR[4] = {0x000003FF, 0x000FFC00, 0x3FF00000, 0x000FFE00};
+
+    integer32 rgb[4];
+    integer32 bgr[4];
+
+    convert_XBGRFFFF_to_XRGB2101010(pixels, rgb, 4);
+    convert_XBGRFFFF_to_XBGR2101010(pixels, bgr, 4);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        if (rgb[i] != expectedRGB[i] || bgr[i] != expectedBGR[i])
+        {
+            printf("     failed: (%f,%f,%f) -> %x and %x\n", pixels[i].r, pixels[i].g, pixels[i].b, rgb[i], bgr[i]);
+            exit(1);
+        }
+    }
+
+    printf("     checking every 10 bit level...\n");
+
+    for (integer32 level = 0; level < 1024; ++level)
+    {
+        const float value = level / 1023.0f;
+        Pixel       pixel(value, value, value);
+        integer32   packed;
+
+        convert_XBGRFFFF_to_XRGB2101010(&pixel, &packed, 1);
+
+        if (packed != ((level << 20) | (level << 10) | level))
+        {
+            printf("     failed: %f -> %x\n", value, packed);
+            exit(1);
+        }
+    }
+
+    printf("     checking blocks against single pixels...\n");
+
+    const unsigned int count = 4099;
+
+    Pixel*     source = new Pixel[count];
+    integer32* blocks = new integer32[count];
+
+    for (unsigned int i = 0; i < count; ++i)
+        source[i] = Pixel((i % 37) / 32.0f - 0.1f, (i % 101) / 100.0f, (i % 13) / 12.0f);
+
+    convert_XBGRFFFF_to_XBGR2101010(source, blocks, count);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        integer32 single;
+
+        convert_XBGRFFFF_to_XBGR2101010(&source[i], &single, 1);
+
+        if (blocks[i] != single)
+        {
+            printf("     failed: (%f,%f,%f) -> %x vs. %x\n", source[i].r, source[i].g, source[i].b, blocks[i], single);
+            exit(1);
+        }
+    }
+
+    delete[] source;
+    delete[] blocks;
+
+    printf("     passed.\n\n");
+}
+
+void test_indexed8()
+{
+    printf("   indexed8 -> truecolor, hicolor and floating point\n");
+
+    TrueColorPixel palette[256];
+
+    for (int i = 0; i < 256; ++i)
+        palette[i] = TrueColorPixel(integer8(i * 7), integer8(255 - i), integer8(i * 13), 255);
+
+    const unsigned int count = 4099;
+
+    integer8* indices = new integer8[count];
+    Pixel*    output  = new Pixel[count]; // big enough for any format
+
+    for (unsigned int i = 0; i < count; ++i)
+        indices[i] = integer8(i * 31 + i / 256);
+
+    const Format formats[4] = {Format::XRGB8888, Format::RGB565, Format::RGB888, Format::XBGRFFFF};
+
+    for (int f = 0; f < 4; ++f)
+    {
+        printf("     checking lookups against conversion of the colors...\n");
+
+        Converter*         converter = requestConverter(Format::XRGB8888, formats[f]);
+        const int          size      = pixelSize(formats[f]);
+        Converter_Indexed8 lookup;
+
+        lookup.palette(palette, 0, 256, converter, size);
+        lookup.convert(indices, output, count);
+
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            integer8 color[16] = {0};
+
+            converter->convert(&palette[indices[i]], color, 1);
+
+            if (memcmp((const integer8*)output + i * size, color, size) != 0)
+            {
+                printf("     failed: format %d, index %d\n", (int)formats[f], indices[i]);
+                exit(1);
+            }
+        }
+
+        printf("     checking palette changes...\n");
+
+        // note: only the changed entries may change, the rest keep their colors
+
+        TrueColorPixel changed[256];
+
+        for (int i = 0; i < 256; ++i)
+            changed[i] = TrueColorPixel(integer32(i * 0x00010203));
+
+        lookup.palette(changed, 100, 200, converter, size);
+        lookup.convert(indices, output, count);
+
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            integer8 color[16] = {0};
+
+            converter->convert(indices[i] >= 100 ? &changed[indices[i]] : &palette[indices[i]], color, 1);
+
+            if (memcmp((const integer8*)output + i * size, color, size) != 0)
+            {
+                printf("     failed: format %d, index %d after palette change\n", (int)formats[f], indices[i]);
+                exit(1);
+            }
+        }
+    }
+
+    delete[] indices;
+    delete[] output;
+
+    printf("     passed.\n\n");
+}
+
+void test_yuv()
+{
+    printf("   yuv -> truecolor\n");
+
+    printf("     checking known values...\n");
+
+    struct Known
+    {
+        ColorSpace colorSpace;
+        int        y, u, v;
+        integer32  expected;
+    };
+
+    const Known known[6] = {
+        {ColorSpace::BT601, 16, 128, 128, 0x000000},
+        {ColorSpace::BT601, 235, 128, 128, 0xFFFFFF},
+        {ColorSpace::BT601, 0, 128, 128, 0x000000},
+        {ColorSpace::BT601, 255, 128, 128, 0xFFFFFF},
+        {ColorSpace::BT709, 16, 128, 128, 0x000000},
+        {ColorSpace::BT709, 235, 128, 128, 0xFFFFFF},
+    };
+
+    for (int i = 0; i < 6; ++i)
+    {
+        int r, g, b;
+
+        yuv_to_rgb(known[i].y, known[i].u, known[i].v, yuvCoefficients(known[i].colorSpace), r, g, b);
+
+        const integer32 color = (r << 16) | (g << 8) | b;
+
+        if (color != known[i].expected)
+        {
+            printf("     failed: (%d,%d,%d) -> %x, expected %x\n", known[i].y, known[i].u, known[i].v, color, known[i].expected);
+            exit(1);
+        }
+    }
+
+    printf("     checking against floating point...\n");
+
+    // the red, green and blue factors of each color space
+
+    const float factors[2][2] = {{0.299f, 0.114f}, {0.2126f, 0.0722f}};
+
+    for (int space = 0; space < 2; ++space)
+    {
+        const ColorSpace      colorSpace = space ? ColorSpace::BT709 : ColorSpace::BT601;
+        const YUVCoefficients k          = yuvCoefficients(colorSpace);
+        const float           kr         = factors[space][0];
+        const float           kb         = factors[space][1];
+        const float           kg         = 1.0f - kr - kb;
+
+        for (int y = 0; y < 256; y += 3)
+        {
+            for (int u = 0; u < 256; u += 5)
+            {
+                for (int v = 0; v < 256; v += 7)
+                {
+                    const float luma = (y - 16) * 255.0f / 219.0f;
+                    const float cb   = (u - 128) * 255.0f / 224.0f;
+                    const float cr   = (v - 128) * 255.0f / 224.0f;
+
+                    const float exact[3] = {luma + 2 * (1 - kr) * cr,
+                                            luma - 2 * (1 - kb) * kb / kg * cb - 2 * (1 - kr) * kr / kg * cr,
+                                            luma + 2 * (1 - kb) * cb};
+
+                    int rgb[3];
+
+                    yuv_to_rgb(y, u, v, k, rgb[0], rgb[1], rgb[2]);
+
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        const float expected = exact[c] < 0.0f ? 0.0f : exact[c] > 255.0f ? 255.0f : exact[c];
+                        if (rgb[c] < expected - 1.0f || rgb[c] > expected + 1.0f)
+                        {
+                            printf("     failed: (%d,%d,%d) -> component %d = %d, expected %f\n", y, u, v, c, rgb[c], expected);
+                            exit(1);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    printf("     checking frames against single pixels...\n");
+
+    // note: odd sizes, so the last pixel of each row and the last row have chroma of their own
+
+    const int width  = 45;
+    const int height = 7;
+
+    const int chromaWidth  = (width + 1) / 2;
+    const int chromaHeight = (height + 1) / 2;
+
+    integer8* luma   = new integer8[width * height];
+    integer8* u      = new integer8[chromaWidth * chromaHeight];
+    integer8* v      = new integer8[chromaWidth * chromaHeight];
+    integer8* nv12   = new integer8[chromaWidth * chromaHeight * 2];
+    integer8* yuy2   = new integer8[chromaWidth * 4 * height];
+    Pixel*    output = new Pixel[width]; // big enough for any format
+
+    for (int i = 0; i < width * height; ++i)
+        luma[i] = integer8(i * 37 + i / 7);
+
+    for (int i = 0; i < chromaWidth * chromaHeight; ++i)
+    {
+        u[i]            = integer8(i * 53 + 11);
+        v[i]            = integer8(i * 29 + 200);
+        nv12[i * 2]     = u[i];
+        nv12[i * 2 + 1] = v[i];
+    }
+
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < chromaWidth; ++x)
+        {
+            integer8* pair = yuy2 + y * chromaWidth * 4 + x * 4;
+            pair[0]        = luma[y * width + x * 2];
+            pair[1]        = u[y / 2 * chromaWidth + x];
+            pair[2]        = x * 2 + 1 < width ? luma[y * width + x * 2 + 1] : 0;
+            pair[3]        = v[y / 2 * chromaWidth + x];
+        }
+    }
+
+    const void* i420Planes[3]  = {luma, u, v};
+    const int   i420Pitches[3] = {width, chromaWidth, chromaWidth};
+    const void* nv12Planes[2]  = {luma, nv12};
+    const int   nv12Pitches[2] = {width, chromaWidth * 2};
+    const void* yuy2Planes[1]  = {yuy2};
+    const int   yuy2Pitches[1] = {chromaWidth * 4};
+
+    const Format       sources[3] = {Format::I420, Format::NV12, Format::YUY2};
+    const void* const* planes[3]  = {i420Planes, nv12Planes, yuy2Planes};
+    const int*         pitches[3] = {i420Pitches, nv12Pitches, yuy2Pitches};
+
+    const Format destinations[12] = {Format::XRGB8888, Format::XBGR8888, Format::ARGB8888, Format::RGB565, Format::BGR565, Format::XRGB1555,
+                                     Format::XBGR1555, Format::RGB888, Format::BGR888, Format::XBGRFFFF, Format::XRGB2101010, Format::XBGR2101010};
+
+    for (int space = 0; space < 2; ++space)
+    {
+        const ColorSpace      colorSpace = space ? ColorSpace::BT709 : ColorSpace::BT601;
+        const YUVCoefficients k          = yuvCoefficients(colorSpace);
+
+        for (int s = 0; s < 3; ++s)
+        {
+            for (int d = 0; d < 12; ++d)
+            {
+                Converter_YUV converter;
+
+                if (!converter.select(sources[s], colorSpace, destinations[d]))
+                {
+                    printf("     failed: no converter from format %d to format %d\n", (int)sources[s], (int)destinations[d]);
+                    exit(1);
+                }
+
+                // translucent video is opaque, everything else goes through truecolor
+
+                Converter* expected = destinations[d] == Format::ARGB8888 ? requestConverter(Format::XRGB8888, Format::XRGB8888) : requestConverter(Format::XRGB8888, destinations[d]);
+                const int  size     = pixelSize(destinations[d]);
+
+                for (int y = 0; y < height; ++y)
+                {
+                    // start on the second pixel of a pair as well as the first
+
+                    for (int start = 0; start < 2; ++start)
+                    {
+                        // note: floating point alpha is left alone, like converting truecolor does
+
+                        for (int x = 0; x < width; ++x)
+                            output[x] = Pixel();
+
+                        converter.convert(planes[s], pitches[s], start, y, output, width - start);
+
+                        for (int x = start; x < width; ++x)
+                        {
+                            const int chroma = y / 2 * chromaWidth + x / 2;
+
+                            int r, g, b;
+
+                            yuv_to_rgb(luma[y * width + x], u[chroma], v[chroma], k, r, g, b);
+
+                            integer32 color     = (r << 16) | (g << 8) | b;
+                            integer8  pixel[16] = {0};
+
+                            if (destinations[d] == Format::ARGB8888)
+                                color |= 0xFF000000;
+
+                            expected->convert(&color, pixel, 1);
+
+                            if (memcmp((const integer8*)output + (x - start) * size, pixel, size) != 0)
+                            {
+                                printf("     failed: format %d to format %d at (%d,%d)\n", (int)sources[s], (int)destinations[d], x, y);
+                                exit(1);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    delete[] luma;
+    delete[] u;
+    delete[] v;
+    delete[] nv12;
+    delete[] yuy2;
+    delete[] output;
+
+    printf("     passed.\n\n");
+}
+
+void test_swapped()
+{
+    printf("   byte order swapping\n");
+
+    printf("     checking known values...\n");
+
+    integer16 short16 = 0x1234;
+    integer32 long32  = 0x12345678;
+
+    swap_bytes(&short16, &short16, 1);
+    swap_bytes(&long32, &long32, 1);
+
+    if (short16 != 0x3412 || long32 != 0x78563412)
+    {
+        printf("     failed: %x and %x\n", short16, long32);
+        exit(1);
+    }
+
+    printf("     checking conversions for the other byte order...\n");
+
+    // each pixel has to have its bytes in the reverse order
+
+    const unsigned int count = 4099;
+
+    Pixel*     source    = new Pixel[count];
+    integer32* converted = new integer32[count];
+    integer32* swapped   = new integer32[count];
+
+    for (unsigned int i = 0; i < count; ++i)
+        source[i] = Pixel((i % 37) / 36.0f, (i % 101) / 100.0f, (i % 13) / 12.0f, 1.0f);
+
+    const Format formats[9] = {Format::XRGB8888, Format::XBGR8888, Format::ARGB8888, Format::XRGB2101010, Format::XBGR2101010,
+                               Format::RGB565, Format::BGR565, Format::XRGB1555, Format::XBGR1555};
+
+    for (int f = 0; f < 9; ++f)
+    {
+        Converter*        converter = requestConverter(Format::XBGRFFFF, formats[f]);
+        const int         size      = pixelSize(formats[f]);
+        Converter_Swapped swapping;
+
+        swapping.select(converter, sizeof(Pixel), size);
+
+        converter->convert(source, converted, count);
+        swapping.convert(source, swapped, count);
+
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            const integer8* bytes    = (const integer8*)swapped + i * size;
+            const integer8* expected = (const integer8*)converted + i * size;
+
+            for (int j = 0; j < size; ++j)
+            {
+                if (bytes[j] != expected[size - 1 - j])
+                {
+                    printf("     failed: format %d, pixel %d, byte %d\n", (int)formats[f], i, j);
+                    exit(1);
+                }
+            }
+        }
+    }
+
+    printf("     checking pixels that are just swapped...\n");
+
+    Converter_Swapped swapping;
+
+    swapping.select(nullptr, 4, 4);
+    swapping.convert(converted, swapped, count);
+    swap_bytes(swapped, swapped, count);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        if (swapped[i] != converted[i])
+        {
+            printf("     failed: pixel %d -> %x, expected %x\n", i, swapped[i], converted[i]);
+            exit(1);
+        }
+    }
+
+    delete[] source;
+    delete[] converted;
+    delete[] swapped;
+
+    printf("     passed.\n\n");
+}
+
+void test_packed24()
+{
+    printf("   packed 24 bit frames\n");
+
+    printf("     checking frames against single pixels...\n");
+
+    // every pixel of a frame has to match converting it on its own, wherever the frame starts
+
+    const unsigned int count = 1027;
+
+    Pixel*     source    = new Pixel[count];
+    integer32* truecolor = new integer32[count];
+    integer8*  frame     = new integer8[count * 3];
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        source[i]    = Pixel((i % 37) / 36.0f, (i % 101) / 100.0f, (i % 13) / 12.0f, 1.0f);
+        truecolor[i] = i * 0x9E3779B1;
+    }
+
+    for (int f = 0; f < 4; ++f)
+    {
+        const bool   floating  = f < 2;
+        const Format format    = f % 2 ? Format::BGR888 : Format::RGB888;
+        Converter*   converter = requestConverter(floating ? Format::XBGRFFFF : Format::XRGB8888, format);
+
+        for (unsigned int start = 0; start < 4; ++start)
+        {
+            if (floating)
+                converter->convert(source + start, frame, count - start);
+            else
+                converter->convert(truecolor + start, frame, count - start);
+
+            for (unsigned int i = 0; i < count - start; ++i)
+            {
+                integer8 pixel[3];
+
+                if (floating)
+                    converter->convert(source + start + i, pixel, 1);
+                else
+                    converter->convert(truecolor + start + i, pixel, 1);
+
+                if (pixel[0] != frame[3 * i] || pixel[1] != frame[3 * i + 1] || pixel[2] != frame[3 * i + 2])
+                {
+                    printf("     failed: format %d, start %d, pixel %d\n", (int)format, start, i);
+                    exit(1);
+                }
+            }
+        }
+    }
+
+    delete[] source;
+    delete[] truecolor;
+    delete[] frame;
+
+    printf("     passed.\n\n");
+}
+
+// the value of a pixel of the given size in bytes, packed 24 bit pixels read lowest byte first
+
+integer32 pixelValue(const integer8* pixel, int size)
+{
+    if (size == 2)
+        return *(const integer16*)pixel;
+    if (size == 4)
+        return *(const integer32*)pixel;
+
+    return pixel[0] | (pixel[1] << 8) | (pixel[2] << 16);
+}
+
+void test_fast()
+{
+    printf("   fast floating point conversion\n");
+
+    printf("     checking error over the full float range...\n");
+
+    // every float but nan, a few thousand pixels at a time so sse2 converts most of them
+
+    const unsigned int count = 4099;
+
+    Pixel*     source = new Pixel[count];
+    integer32* exact  = new integer32[count];
+    integer32* fast   = new integer32[count];
+
+    const integer32 step = 97;
+
+    integer64 bits = 0;
+
+    while (bits <= 0xFFFFFFFF)
+    {
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            float* components = &source[i].r;
+
+            for (int j = 0; j < 3; ++j)
+            {
+                FloatInteger value;
+                value.i = (integer32)bits;
+                bits += step;
+
+                components[j] = value.f == value.f ? value.f : 0.0f;
+            }
+
+            source[i].a = 0.0f;
+        }
+
+        convert_XBGRFFFF_to_XRGB8888(source, exact, count);
+        convert_XBGRFFFF_to_XRGB8888_fast(source, fast, count);
+
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            for (int shift = 0; shift < 24; shift += 8)
+            {
+                const int difference = (int)((exact[i] >> shift) & 0xFF) - (int)((fast[i] >> shift) & 0xFF);
+
+                if (difference < 0 || difference > 1 || (fast[i] & 0xFF000000))
+                {
+                    printf("     failed: (%g,%g,%g) -> %x, exact %x\n", source[i].r, source[i].g, source[i].b, fast[i], exact[i]);
+                    exit(1);
+                }
+            }
+        }
+    }
+
+    printf("     checking formats against exact conversion...\n");
+
+    // each component is at most one step of the format off, and frames match single pixels wherever they start
+
+    struct
+    {
+        Format    format;
+        integer32 masks[3];
+    } formats[8] = {{Format::XRGB8888, {0xFF0000, 0x00FF00, 0x0000FF}}, {Format::XBGR8888, {0x0000FF, 0x00FF00, 0xFF0000}},
+                    {Format::RGB888, {0x0000FF, 0x00FF00, 0xFF0000}},   {Format::BGR888, {0xFF0000, 0x00FF00, 0x0000FF}},
+                    {Format::RGB565, {0xF800, 0x07E0, 0x001F}},         {Format::BGR565, {0x001F, 0x07E0, 0xF800}},
+                    {Format::XRGB1555, {0x7C00, 0x03E0, 0x001F}},       {Format::XBGR1555, {0x001F, 0x03E0, 0x7C00}}};
+
+    for (unsigned int i = 0; i < count; ++i)
+        source[i] = Pixel((i % 1031) / 1000.0f - 0.01f, (i % 257) / 256.0f, (i % 64) / 63.0f, 1.0f);
+
+    integer8* exactFrame = new integer8[count * 4];
+    integer8* fastFrame  = new integer8[count * 4];
+
+    for (int f = 0; f < 8; ++f)
+    {
+        Converter*     converter = requestConverter(Format::XBGRFFFF, formats[f].format);
+        const int      size      = pixelSize(formats[f].format);
+        Converter_Fast fastConverter;
+
+        if (!fastConverter.select(formats[f].format))
+        {
+            printf("     failed: no fast converter for format %d\n", (int)formats[f].format);
+            exit(1);
+        }
+
+        for (unsigned int start = 0; start < 4; ++start)
+        {
+            converter->convert(source + start, exactFrame, count - start);
+            fastConverter.convert(source + start, fastFrame, count - start);
+
+            for (unsigned int i = 0; i < count - start; ++i)
+            {
+                integer8 pixel[4];
+
+                fastConverter.convert(source + start + i, pixel, 1);
+
+                const integer32 exactValue  = pixelValue(exactFrame + i * size, size);
+                const integer32 fastValue   = pixelValue(fastFrame + i * size, size);
+                const integer32 singleValue = pixelValue(pixel, size);
+
+                bool failed = fastValue != singleValue;
+
+                for (int c = 0; c < 3; ++c)
+                {
+                    const integer32 mask = formats[f].masks[c];
+                    const integer32 unit = mask & (0 - mask);
+                    const int       difference = (int)((exactValue & mask) / unit) - (int)((fastValue & mask) / unit);
+
+                    if (difference < 0 || difference > 1)
+                        failed = true;
+                }
+
+                if (failed)
+                {
+                    printf("     failed: format %d, start %d, pixel %d -> %x, single %x, exact %x\n", (int)formats[f].format, start, i, fastValue, singleValue, exactValue);
+                    exit(1);
+                }
+            }
+        }
+    }
+
+    delete[] source;
+    delete[] exact;
+    delete[] fast;
+    delete[] exactFrame;
+    delete[] fastFrame;
+
+    printf("     passed.\n\n");
+}
+
+void test_conversion()
+{
+    printf("testing pixel format conversion:\n\n");
+
+    test_truecolor_to_truecolor();
+    test_truecolor_to_xbgr1555();
+    test_truecolor_to_xrgb1555();
+    test_truecolor_to_bgr565();
+    test_truecolor_to_rgb565();
+    test_truecolor_to_bgr888();
+    test_truecolor_to_rgb888();
+    test_truecolor_to_xbgr8888();
+
+    test_clamped_fraction();
+    test_floating_point_to_xrgb8888();
+    test_floating_point_to_xbgr8888();
+    test_floating_point_to_rgb888();
+    test_floating_point_to_bgr888();
+    test_floating_point_to_rgb565();
+    test_floating_point_to_bgr565();
+    test_floating_point_to_xrgb1555();
+    test_floating_point_to_xbgr1555();
+
+    test_truecolor_to_argb8888();
+    test_floating_point_to_argb8888();
+
+    test_truecolor_to_2101010();
+    test_floating_point_to_2101010();
+
+    test_indexed8();
+    test_yuv();
+    test_swapped();
+    test_packed24();
+    test_fast();
+}
+
+// ----------------------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------------------
+
+class EventQueueTestDisplay : public DisplayAdapter
+{
+public:
+    void push(Event::Type type, double time)
+    {
+        queueEvent(type, time, Key::A, nullptr, false);
+    }
+};
+
+void test_event_queue()
+{
+    printf("testing event queue:\n\n");
+
+    EventQueueTestDisplay display;
+    Event                 event;
+
+    printf("   not queueing\n");
+    {
+        display.push(Event::KeyDown, 1.0);
+        if (display.pollEvent(event))
+        {
+            printf("\n     failed: event queued without queueing enabled\n");
+            exit(1);
+        }
+    }
+
+    display.queueEvents(true);
+
+    printf("   first in first out\n");
+    {
+        display.push(Event::KeyDown, 1.0);
+        display.push(Event::KeyUp, 2.0);
+
+        if (!display.pollEvent(event) || event.type != Event::KeyDown || event.time != 1.0 || event.key != Key::A ||
+            !display.pollEvent(event) || event.type != Event::KeyUp || event.time != 2.0 ||
+            display.pollEvent(event))
+        {
+            printf("\n     failed: events out of order\n");
+            exit(1);
+        }
+    }
+
+    printf("   overflow\n");
+    {
+        for (int i = 0; i < 1000; ++i)
+            display.push(Event::MouseMove, i);
+
+        int count = 0;
+        while (display.pollEvent(event))
+        {
+            if (event.time != count)
+            {
+                printf("\n     failed: expected event %d, got %f\n", count, event.time);
+                exit(1);
+            }
+            count++;
+        }
+
+        if (count != 256)
+        {
+            printf("\n     failed: expected 256 queued events, got %d\n", count);
+            exit(1);
+        }
+    }
+
+    printf("\n");
+}
+
+class MotionTestListener : public Listener
+{
+public:
+    MotionTestListener()
+    {
+        motions = 0;
+        moves   = 0;
+    }
+
+    void onMouseMotion(DisplayInterface& display, const Mouse samples[], int count, float dx, float dy) override
+    {
+        motions++;
+        this->count = count;
+        first       = samples[0];
+        last        = samples[count - 1];
+        this->dx    = dx;
+        this->dy    = dy;
+    }
+
+    void onMouseMove(DisplayInterface& display, Mouse mouse) override
+    {
+        moves++;
+        latest = mouse;
+    }
+
+    int   motions;
+    int   moves;
+    int   count;
+    Mouse first;
+    Mouse last;
+    Mouse latest;
+    float dx;
+    float dy;
+};
+
+void test_mouse_motion()
+{
+    printf("testing mouse motion coalescing:\n\n");
+
+    DisplayAdapter     display;
+    MotionTestListener listener;
+    MouseMotionBuffer  buffer;
+    Mouse              mouse = Mouse();
+
+    printf("   one callback per run\n");
+    {
+        for (int i = 0; i < 10; ++i)
+        {
+            mouse.x = (float)i;
+            mouse.y = (float)(2 * i);
+            buffer.add(&listener, display, mouse);
+        }
+
+        if (listener.motions != 0 || listener.moves != 0)
+        {
+            printf("\n     failed: moves sent before flushing\n");
+            exit(1);
+        }
+
+        buffer.flush(&listener, display);
+
+        if (listener.motions != 1 || listener.moves != 1 || listener.count != 10 || listener.first.x != 0.0f || listener.last.x != 9.0f ||
+            listener.latest.x != 9.0f || listener.latest.y != 18.0f)
+        {
+            printf("\n     failed: %d motion and %d move callbacks for %d samples\n", listener.motions, listener.moves, listener.count);
+            exit(1);
+        }
+
+        buffer.flush(&listener, display);
+
+        if (listener.motions != 1 || listener.moves != 1)
+        {
+            printf("\n     failed: flushing nothing sent a callback\n");
+            exit(1);
+        }
+    }
+
+    printf("   accumulated distance\n");
+    {
+        // the first run moves from its first sample, later ones from the latest position of the run before
+
+        if (listener.dx != 9.0f || listener.dy != 18.0f)
+        {
+            printf("\n     failed: first run moved %f, %f\n", listener.dx, listener.dy);
+            exit(1);
+        }
+
+        for (int i = 0; i < 3; ++i)
+        {
+            mouse.x = 20.0f + i;
+            mouse.y = 10.0f;
+            buffer.add(&listener, display, mouse);
+        }
+
+        buffer.flush(&listener, display);
+
+        if (listener.count != 3 || listener.dx != 13.0f || listener.dy != -8.0f)
+        {
+            printf("\n     failed: second run of %d moved %f, %f\n", listener.count, listener.dx, listener.dy);
+            exit(1);
+        }
+
+        buffer.reset();
+
+        mouse.x = 100.0f;
+        buffer.add(&listener, display, mouse);
+        buffer.flush(&listener, display);
+
+        if (listener.dx != 0.0f || listener.dy != 0.0f)
+        {
+            printf("\n     failed: run after reset moved %f, %f\n", listener.dx, listener.dy);
+            exit(1);
+        }
+    }
+
+    printf("   full buffer\n");
+    {
+        const int motions = listener.motions;
+
+        for (int i = 0; i < 300; ++i)
+        {
+            mouse.x = (float)i;
+            buffer.add(&listener, display, mouse);
+        }
+
+        if (listener.motions != motions + 1 || listener.count != 256 || listener.last.x != 255.0f)
+        {
+            printf("\n     failed: a full buffer sent %d callbacks of %d samples\n", listener.motions - motions, listener.count);
+            exit(1);
+        }
+
+        buffer.flush(&listener, display);
+
+        if (listener.motions != motions + 2 || listener.count != 44 || listener.first.x != 256.0f || listener.dx != 44.0f)
+        {
+            printf("\n     failed: the rest of a full buffer came as %d samples\n", listener.count);
+            exit(1);
+        }
+    }
+
+    printf("\n");
+}
+
+class ViewportTestDisplay : public DisplayAdapter
+{
+public:
+    using DisplayAdapter::update;
+
+    TrueColorPixel shown[12];
+
+protected:
+    bool update(const TrueColorPixel* trueColorPixels, const FloatingPointPixel* floatingPointPixels, const Rectangle* dirtyBox) override
+    {
+        for (int i = 0; i < 12; ++i)
+            shown[i] = trueColorPixels[i];
+        return true;
+    }
+};
+
+void test_viewport()
+{
+    printf("testing viewport updates:\n\n");
+
+    ViewportTestDisplay display;
+    display.open("viewport", 4, 3, Output::Default, Mode::FloatingPoint);
+
+    TrueColorPixel canvas[10 * 8];
+    for (int i = 0; i < 10 * 8; ++i)
+        canvas[i].integer = i;
+
+    printf("   reading the viewport\n");
+    {
+        if (!display.update(canvas, Format::XRGB8888, 10 * 4, 3, 2, nullptr))
+        {
+            printf("\n     failed: viewport update\n");
+            exit(1);
+        }
+
+        for (int y = 0; y < 3; ++y)
+        {
+            for (int x = 0; x < 4; ++x)
+            {
+                if (display.shown[y * 4 + x].integer != (integer32)((y + 2) * 10 + x + 3))
+                {
+                    printf("\n     failed: pixel %d, %d shows %d\n", x, y, display.shown[y * 4 + x].integer);
+                    exit(1);
+                }
+            }
+        }
+
+        // a canvas as wide as the display goes through without copying
+
+        if (!display.update(canvas, Format::XRGB8888, 4 * 4, 0, 1, nullptr) || display.shown[0].integer != 4 || display.shown[11].integer != 15)
+        {
+            printf("\n     failed: packed viewport update\n");
+            exit(1);
+        }
+    }
+
+    printf("   rejecting viewports off the canvas\n");
+    {
+        if (display.update(canvas, Format::XRGB8888, 3 * 4, 0, 0, nullptr) || display.update(canvas, Format::XRGB8888, 10 * 4, -1, 0, nullptr) ||
+            display.update(canvas, Format::XRGB8888, 10 * 4, 0, -1, nullptr) || display.update(canvas, Format::XRGB8888, 10 * 4, 7, 0, nullptr) ||
+            display.update(canvas, Format::Unknown, 10 * 4, 0, 0, nullptr))
+        {
+            printf("\n     failed: invalid viewport accepted\n");
+            exit(1);
+        }
+    }
+
+    printf("\n");
+}
+
+// converts frames to a destination format at its quality, sharing the conversions of other displays
+// through a cache keyed the way the unix displays key theirs
+
+class ConversionTestDisplay : public DisplayAdapter
+{
+public:
+    enum
+    {
+        width  = 64,
+        height = 64,
+        count  = width * height
+    };
+
+    explicit ConversionTestDisplay(Quality quality)
+    {
+        open("conversion", width, height, Output::Default, Mode::FloatingPoint);
+        this->quality(quality);
+    }
+
+    ~ConversionTestDisplay()
+    {
+        for (int i = 0; i < cacheSize; ++i)
+        {
+            if (cache[i].owner == this)
+                cache[i].owner = nullptr;
+        }
+    }
+
+    // get the converted frame, either our own conversion or the one of a display with the same key
+
+    const integer16* convert(const void* pixels, Format sourceFormat, Format destFormat)
+    {
+        const int           pitch = width * pixelSize(sourceFormat);
+        const ConversionKey key(pixels, count, pitch, sourceFormat, destFormat, quality());
+
+        for (int i = 0; i < cacheSize; ++i)
+        {
+            if (cache[i].owner && cache[i].key == key)
+                return cache[i].owner->converted;
+        }
+
+        Converter_Fast fast;
+        Converter*     converter = requestConverter(sourceFormat, destFormat);
+
+        if (sourceFormat == Format::XBGRFFFF && quality() == Quality::Fast && fast.select(destFormat))
+            converter = &fast;
+
+        converter->convert(pixels, converted, count);
+
+        for (int i = 0; i < cacheSize; ++i)
+        {
+            if (!cache[i].owner || cache[i].owner == this)
+            {
+                cache[i].key   = key;
+                cache[i].owner = this;
+                break;
+            }
+        }
+
+        return converted;
+    }
+
+private:
+    struct CachedFrame
+    {
+        ConversionKey          key;
+        ConversionTestDisplay* owner;
+    };
+
+    enum
+    {
+        cacheSize = 4
+    };
+
+    integer16 converted[count * 2]; // room for count pixels of up to four bytes
+
+    static CachedFrame cache[cacheSize];
+};
+
+ConversionTestDisplay::CachedFrame ConversionTestDisplay::cache[ConversionTestDisplay::cacheSize];
+
+// displays sharing a conversion have to agree on everything that changes the converted bytes
+
+void test_conversion_sharing()
+{
+    printf("testing conversion sharing:\n\n");
+
+    const int count = ConversionTestDisplay::count;
+
+    vector<Pixel>     floatingPoint(count);
+    vector<integer32> trueColor(count);
+
+    // red is just under a step of 1/256, where exact conversion rounds up and fast conversion truncates
+
+    for (int i = 0; i < count; ++i)
+    {
+        floatingPoint[i] = Pixel(nextafterf((i % 255 + 1) / 256.0f, 0.0f), (i % 97) / 96.0f, (i % 13) / 12.5f, 1.0f);
+        trueColor[i]     = i * 0x010203;
+    }
+
+    printf("   floating point frames\n");
+    {
+        ConversionTestDisplay exact(Quality::Exact);
+        ConversionTestDisplay fast(Quality::Fast);
+        ConversionTestDisplay another(Quality::Exact);
+
+        const integer16* exactPixels   = exact.convert(&floatingPoint[0], Format::XBGRFFFF, Format::XRGB8888);
+        const integer16* fastPixels    = fast.convert(&floatingPoint[0], Format::XBGRFFFF, Format::XRGB8888);
+        const integer16* anotherPixels = another.convert(&floatingPoint[0], Format::XBGRFFFF, Format::XRGB8888);
+
+        // the fast display converts the frame itself, and shows the fast conversion rather than the exact one
+
+        vector<integer32> expected(count);
+        vector<integer32> expectedFast(count);
+        Converter_Fast    converter;
+
+        requestConverter(Format::XBGRFFFF, Format::XRGB8888)->convert(&floatingPoint[0], &expected[0], count);
+        converter.select(Format::XRGB8888);
+        converter.convert(&floatingPoint[0], &expectedFast[0], count);
+
+        if (fastPixels == exactPixels || memcmp(fastPixels, &expectedFast[0], count * 4) != 0)
+        {
+            printf("\n     failed: the fast display showed the exact conversion\n");
+            exit(1);
+        }
+
+#ifdef PIXELTOASTER_USE_SSE2
+        // note: without sse2 fast conversion is the exact one
+
+        if (memcmp(fastPixels, exactPixels, count * 4) == 0)
+        {
+            printf("\n     failed: fast and exact conversion agree on every pixel\n");
+            exit(1);
+        }
+#endif
+
+        if (anotherPixels != exactPixels || memcmp(anotherPixels, &expected[0], count * 4) != 0)
+        {
+            printf("\n     failed: exact displays don't share their conversion\n");
+            exit(1);
+        }
+    }
+
+    printf("   truecolor frames\n");
+    {
+        // quality only changes floating point conversions, so truecolor ones are shared whatever the quality
+
+        ConversionTestDisplay exact(Quality::Exact);
+        ConversionTestDisplay fast(Quality::Fast);
+
+        const integer16* exactPixels = exact.convert(&trueColor[0], Format::XRGB8888, Format::RGB565);
+        const integer16* fastPixels  = fast.convert(&trueColor[0], Format::XRGB8888, Format::RGB565);
+
+        vector<integer16> expected(count);
+        requestConverter(Format::XRGB8888, Format::RGB565)->convert(&trueColor[0], &expected[0], count);
+
+        if (fastPixels != exactPixels || memcmp(fastPixels, &expected[0], count * 2) != 0)
+        {
+            printf("\n     failed: quality keeps displays from sharing a truecolor conversion\n");
+            exit(1);
+        }
+    }
+
+    printf("\n");
+}
+
+void test_pixel_memory()
+{
+    printf("testing pixel memory:\n\n");
+
+    printf("   allocating and freeing\n");
+    {
+        // every size has to come back aligned to a cache line, and hold what was written to it until it is freed
+
+        const integer64 sizes[6] = {0, 1, 1000, 2 * 1024 * 1024 - 1, 2 * 1024 * 1024, 3 * 1024 * 1024 + 1};
+
+        for (int i = 0; i < 6; ++i)
+        {
+            unsigned char* pixels = static_cast<unsigned char*>(allocatePixels(sizes[i]));
+
+            if (!pixels || (reinterpret_cast<integer64>(pixels) & 63))
+            {
+                printf("\n     failed: %llu bytes at %p\n", sizes[i], (void*)pixels);
+                exit(1);
+            }
+
+            for (integer64 j = 0; j < sizes[i]; ++j)
+                pixels[j] = (unsigned char)(j * 7);
+
+            for (integer64 j = 0; j < sizes[i]; ++j)
+            {
+                if (pixels[j] != (unsigned char)(j * 7))
+                {
+                    printf("\n     failed: byte %llu of %llu changed\n", j, sizes[i]);
+                    exit(1);
+                }
+            }
+
+            freePixels(pixels);
+        }
+
+        freePixels(nullptr);
+    }
+
+#if PIXELTOASTER_PLATFORM == PIXELTOASTER_UNIX
+
+    printf("   huge pages\n");
+    {
+        // a huge page and up starts right on a huge page boundary, and freeing has to unmap every one of them again
+
+        const size_t sizes[3] = {hugePageSize, hugePageSize + 1, 3 * hugePageSize};
+
+        for (int i = 0; i < 3; ++i)
+        {
+            char* pixels = static_cast<char*>(allocatePixelMemory(sizes[i]));
+
+            if (!pixels || (reinterpret_cast<uintptr_t>(pixels) & (hugePageSize - 1)))
+            {
+                printf("\n     failed: %d bytes at %p\n", (int)sizes[i], (void*)pixels);
+                exit(1);
+            }
+
+            pixels[0]            = 1;
+            pixels[sizes[i] - 1] = 2;
+
+            freePixelMemory(pixels);
+        }
+
+        if (hugePageMappings)
+        {
+            printf("\n     failed: huge page mapping left after freeing\n");
+            exit(1);
+        }
+    }
+
+    printf("   growing dirty vectors\n");
+    {
+        DirtyVector<integer32> buffer;
+
+        if (!buffer.reserve(100) || (reinterpret_cast<uintptr_t>(buffer.get()) & 63))
+        {
+            printf("\n     failed: no aligned storage for 100 elements\n");
+            exit(1);
+        }
+
+        integer32* const small = buffer.get();
+
+        if (!buffer.reserve(50) || buffer.get() != small)
+        {
+            printf("\n     failed: reserving less reallocated\n");
+            exit(1);
+        }
+
+        // growing by one element doubles the storage, so up to twice as much fits without reallocating
+
+        buffer.reserve(101);
+
+        integer32* const doubled = buffer.get();
+
+        if (!buffer.reserve(200) || buffer.get() != doubled)
+        {
+            printf("\n     failed: storage did not grow geometrically\n");
+            exit(1);
+        }
+
+        for (int i = 0; i < 200; ++i)
+            buffer[i] = i;
+
+        if (!buffer.reserve(1000) || buffer.get() == doubled)
+        {
+            printf("\n     failed: could not grow past double\n");
+            exit(1);
+        }
+
+        buffer[999] = 999;
+    }
+
+#endif
+
+    printf("   frame buffers\n");
+    {
+        FrameBuffer<Pixel> empty;
+
+        if (empty.size() != 0 || empty.data() != nullptr)
+        {
+            printf("\n     failed: default frame buffer is not empty\n");
+            exit(1);
+        }
+
+        FrameBuffer<Pixel> frame(1000);
+
+        if (frame.size() != 1000 || !frame.data() || (reinterpret_cast<integer64>(frame.data()) & 63))
+        {
+            printf("\n     failed: frame buffer of 1000 pixels\n");
+            exit(1);
+        }
+
+        frame[999] = Pixel(1.0f, 1.0f, 1.0f, 1.0f);
+
+        // resizing throws the pixels away, they all start out black again
+
+        if (!frame.resize(1024 * 1024) || frame.size() != 1024 * 1024 || (reinterpret_cast<integer64>(frame.data()) & 63))
+        {
+            printf("\n     failed: resizing to 1024 * 1024 pixels\n");
+            exit(1);
+        }
+
+        for (int i = 0; i < frame.size(); ++i)
+        {
+            if (frame[i].r != 0.0f || frame[i].g != 0.0f || frame[i].b != 0.0f || frame[i].a != 0.0f)
+            {
+                printf("\n     failed: pixel %d is not black\n", i);
+                exit(1);
+            }
+        }
+
+        if (!frame.resize(0) || frame.size() != 0 || frame.data() != nullptr)
+        {
+            printf("\n     failed: resizing to nothing\n");
+            exit(1);
+        }
+    }
+
+    printf("\n");
+}
+
+#if PIXELTOASTER_PLATFORM == PIXELTOASTER_UNIX
+
+void test_frame_scrolling()
+{
+    printf("testing frame scrolling:\n\n");
+
+    const int width  = 7;
+    const int height = 5;
+
+    const int steps[9][2] = {{0, 0}, {3, 0}, {-3, 0}, {0, 2}, {0, -2}, {2, -1}, {-4, 3}, {6, 4}, {-6, -4}};
+
+    for (int size = 3; size <= 4; ++size)
+    {
+        printf("   %d byte pixels\n", size);
+
+        for (int s = 0; s < 9; ++s)
+        {
+            const int dx = steps[s][0];
+            const int dy = steps[s][1];
+
+            // every byte of the frame tells where it came from
+
+            char original[width * height * 4];
+            char frame[width * height * 4];
+
+            for (int i = 0; i < width * height * size; ++i)
+                original[i] = frame[i] = (char)i;
+
+            moveFrame(frame, width, height, size, dx, dy);
+
+            // pixels still in view moved by dx, dy, the ones scrolled into view are left alone
+
+            for (int y = 0; y < height; ++y)
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    const int fromX = x - dx;
+                    const int fromY = y - dy;
+                    const int from  = fromX >= 0 && fromX < width && fromY >= 0 && fromY < height ? fromY * width + fromX : y * width + x;
+
+                    if (memcmp(frame + (y * width + x) * size, original + from * size, size) != 0)
+                    {
+                        printf("\n     failed: scrolling by %d, %d moved the wrong pixel to %d, %d\n", dx, dy, x, y);
+                        exit(1);
+                    }
+                }
+            }
+        }
+    }
+
+    printf("\n");
+}
+
+// records the key events sent for held keys, in order
+
+class KeyTestListener : public Listener
+{
+public:
+    KeyTestListener()
+    {
+        count = 0;
+    }
+
+    void onKeyPressed(DisplayInterface& display, Key key) override
+    {
+        record(display, key, false);
+    }
+
+    void onKeyUp(DisplayInterface& display, Key key) override
+    {
+        record(display, key, true);
+    }
+
+    void record(DisplayInterface& display, Key key, bool up)
+    {
+        displays[count] = &display;
+        keys[count]     = key;
+        ups[count]      = up;
+        count++;
+    }
+
+    // true if the events since the last check were the given keys, pressed or up
+
+    bool sent(int expected, const Key expectedKeys[], const bool expectedUps[], DisplayInterface* display)
+    {
+        bool same = count == expected;
+
+        for (int i = 0; i < count && same; ++i)
+            same = keys[i] == expectedKeys[i] && ups[i] == expectedUps[i] && displays[i] == display;
+
+        count = 0;
+        return same;
+    }
+
+    DisplayInterface* displays[16];
+    Key               keys[16];
+    bool              ups[16];
+    int               count;
+};
+
+void test_key_state()
+{
+    printf("testing held keys:\n\n");
+
+    DisplayAdapter  first;
+    DisplayAdapter  second;
+    KeyTestListener listener;
+
+    printf("   pressing and releasing\n");
+    {
+        UnixKeyState keys;
+
+        if (!keys.press(Key::A) || keys.press(Key::A))
+        {
+            printf("\n     failed: a held key went down twice\n");
+            exit(1);
+        }
+
+        if (keys.release(Key::B) || !keys.release(Key::A) || keys.release(Key::A))
+        {
+            printf("\n     failed: released a key that was not held\n");
+            exit(1);
+        }
+
+        // a tap between two frames is still seen as pressed, then goes up
+
+        const Key  tapped[1]   = {Key::A};
+        const bool tappedUp[1] = {true};
+
+        keys.send(&listener, first);
+
+        if (!listener.sent(1, tapped, tappedUp, &first))
+        {
+            printf("\n     failed: tapped key not sent as up\n");
+            exit(1);
+        }
+
+        keys.send(&listener, first);
+
+        if (!listener.sent(0, nullptr, nullptr, &first) || !keys.press(Key::A))
+        {
+            printf("\n     failed: key still held after going up\n");
+            exit(1);
+        }
+    }
+
+    printf("   held key order\n");
+    {
+        UnixKeyState keys;
+
+        keys.press(Key::C);
+        keys.press(Key::A);
+        keys.press(Key::B);
+        keys.release(Key::A);
+
+        // keys are sent in the order they went down, released ones drop out of the list without reordering the rest
+
+        const Key  all[3]      = {Key::C, Key::A, Key::B};
+        const bool allUps[3]   = {false, true, false};
+        const Key  rest[2]     = {Key::C, Key::B};
+        const bool restUps[2]  = {false, false};
+        const Key  again[3]    = {Key::C, Key::B, Key::A};
+        const bool againUps[3] = {false, false, false};
+
+        keys.send(&listener, first);
+
+        if (!listener.sent(3, all, allUps, &first))
+        {
+            printf("\n     failed: held keys sent out of order\n");
+            exit(1);
+        }
+
+        keys.send(&listener, first);
+
+        if (!listener.sent(2, rest, restUps, &first))
+        {
+            printf("\n     failed: released key still in the held list\n");
+            exit(1);
+        }
+
+        keys.press(Key::A);
+        keys.send(&listener, first);
+
+        if (!listener.sent(3, again, againUps, &first))
+        {
+            printf("\n     failed: key pressed again not added at the end\n");
+            exit(1);
+        }
+    }
+
+    printf("   releasing every key\n");
+    {
+        UnixKeyState keys;
+
+        keys.press(Key::Left);
+        keys.press(Key::Space);
+        keys.send(&listener, first);
+        listener.count = 0;
+
+        Key       released[256];
+        const int count = keys.releaseAll(released);
+
+        const Key  both[2]    = {Key::Left, Key::Space};
+        const bool bothUps[2] = {true, true};
+
+        if (count != 2 || released[0] != Key::Left || released[1] != Key::Space)
+        {
+            printf("\n     failed: released %d keys\n", count);
+            exit(1);
+        }
+
+        keys.send(&listener, first);
+
+        if (!listener.sent(2, both, bothUps, &first))
+        {
+            printf("\n     failed: released keys not sent as up\n");
+            exit(1);
+        }
+
+        // nothing is left held, neither in the list nor in the bitsets
+
+        keys.send(&listener, first);
+
+        if (!listener.sent(0, nullptr, nullptr, &first) || keys.releaseAll(released) != 0 || !keys.press(Key::Left) || !keys.press(Key::Space))
+        {
+            printf("\n     failed: keys still held after releasing them all\n");
+            exit(1);
+        }
+    }
+
+    printf("   separate displays\n");
+    {
+        UnixKeyState firstKeys;
+        UnixKeyState secondKeys;
+
+        firstKeys.press(Key::Escape);
+
+        const Key  escape[1]   = {Key::Escape};
+        const bool escapeUp[1] = {false};
+
+        secondKeys.send(&listener, second);
+
+        if (!listener.sent(0, nullptr, nullptr, &second) || !secondKeys.press(Key::Escape))
+        {
+            printf("\n     failed: a key held on one display is held on the other\n");
+            exit(1);
+        }
+
+        Key released[256];
+        secondKeys.releaseAll(released);
+        secondKeys.send(&listener, second);
+        listener.count = 0;
+
+        firstKeys.send(&listener, first);
+
+        if (!listener.sent(1, escape, escapeUp, &first))
+        {
+            printf("\n     failed: releasing the keys of one display released the other's\n");
+            exit(1);
+        }
+    }
+
+    printf("\n");
+}
+
+#endif
 
 int main()
 {
@@ -3804,6 +5587,15 @@ int main()
 
     test_conversion();
     test_converter_objects();
+    test_event_queue();
+    test_mouse_motion();
+    test_viewport();
+    test_conversion_sharing();
+    test_pixel_memory();
+#if PIXELTOASTER_PLATFORM == PIXELTOASTER_UNIX
+    test_frame_scrolling();
+    test_key_state();
+#endif
 
     printf("test completed successfully!\n\n");
 